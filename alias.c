@@ -18,7 +18,7 @@
 
 #include	"include.h"
 
-static SYM_TABLE
+static ASSEMBLY_STATE SYM_TABLE
 	*aliasSymbols;						// alias symbol list is kept here
 
 ALIAS_RECORD *MatchAlias(const char *operand)
@@ -130,6 +130,7 @@ bool HandleAliasMatches(char *line,unsigned int *lineIndex,LISTING_RECORD *listi
 
 void DestroyAlias(ALIAS_RECORD *alias)
 // remove alias from existence
+// NOTE: the record is in the pass arena, so its memory goes when the arena is reset
 {
 	STRemoveEntry(aliasSymbols,alias->symbol);
 
@@ -146,7 +147,6 @@ void DestroyAlias(ALIAS_RECORD *alias)
 	{
 		aliasesHead=alias->next;
 	}
-	DisposePtr(alias);
 }
 
 void DestroyAliases()
@@ -167,7 +167,7 @@ ALIAS_RECORD *CreateAlias(const char *aliasName,const char *aliasString)
 		*record;
 
 	length=strlen(aliasString);
-	if((record=(ALIAS_RECORD *)NewPtr(sizeof(ALIAS_RECORD)+length+1)))
+	if((record=(ALIAS_RECORD *)ArenaNewPtr(passArena,sizeof(ALIAS_RECORD)+length+1)))
 	{
 		record->whereFrom.file=currentVirtualFile;
 		record->whereFrom.fileLineNumber=currentVirtualFileLine;
@@ -185,7 +185,6 @@ ALIAS_RECORD *CreateAlias(const char *aliasName,const char *aliasString)
 			aliasesHead=record;
 			return(record);
 		}
-		DisposePtr(record);
 	}
 	return(NULL);
 }
@@ -199,7 +198,7 @@ void UnInitAliases()
 bool InitAliases()
 // initialize symbol table for aliases
 {
-	if((aliasSymbols=STNewSymbolTable(0)))
+	if((aliasSymbols=STNewArenaSymbolTable(0,passArena)))
 	{
 		return(true);
 	}
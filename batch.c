@@ -0,0 +1,411 @@
+//	Copyright (C) 1999-2012 Core Technologies.
+//
+//	This file is part of tpasm.
+//
+//	tpasm is free software; you can redistribute it and/or modify
+//	it under the terms of the tpasm LICENSE AGREEMENT.
+//
+//	tpasm is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	tpasm LICENSE AGREEMENT for more details.
+//
+//	You should have received a copy of the tpasm LICENSE AGREEMENT
+//	along with tpasm; see the file "LICENSE.TXT".
+
+
+// Run many assemblies described by a manifest file, spread across a pool of worker threads
+// (or run one after another where there are no threads).
+// Each line of the manifest holds the options for one assembly, given just as they
+// would be on the command line. Blank lines, and lines starting with ';' are ignored.
+// Arguments are separated by white space, and may be enclosed in double quotes.
+
+#include	"include.h"
+#ifndef NO_THREADS
+#include	<pthread.h>
+#include	<unistd.h>
+#endif
+
+struct BATCH_ENTRY
+{
+	BATCH_ENTRY
+		*next;								// next entry of the manifest (NULL if none)
+	unsigned int
+		lineNumber;							// line of the manifest this came from
+	bool
+		failed;								// set if the assembly failed, or had errors
+	unsigned int
+		argc;								// number of arguments in argv (including the program name)
+	char
+		*argv[1];							// variable length argument list (NULL terminated), followed by the argument text
+};
+
+static bool ParseManifestArgument(const char *line,unsigned int *lineIndex,char *argument,unsigned int *argumentLength,bool *unterminated)
+// Parse the next argument from a manifest line into argument (0 terminated)
+// return false if there are no more arguments on the line
+// If a quoted argument is not terminated, set unterminated, and return false
+{
+	bool
+		inQuote;
+
+	*unterminated=false;
+	while(line[*lineIndex]&&isspace((unsigned char)line[*lineIndex]))
+	{
+		(*lineIndex)++;
+	}
+	if(line[*lineIndex])
+	{
+		*argumentLength=0;
+		inQuote=false;
+		while(line[*lineIndex]&&(inQuote||!isspace((unsigned char)line[*lineIndex])))
+		{
+			if(line[*lineIndex]=='"')
+			{
+				inQuote=!inQuote;
+			}
+			else
+			{
+				argument[(*argumentLength)++]=line[*lineIndex];
+			}
+			(*lineIndex)++;
+		}
+		argument[*argumentLength]='\0';
+		if(!inQuote)
+		{
+			return(true);
+		}
+		*unterminated=true;
+	}
+	return(false);
+}
+
+static bool CreateBatchEntry(const char *manifestName,unsigned int lineNumber,const char *line,BATCH_ENTRY **entry)
+// Make a batch entry out of the arguments on line
+// If the line holds no arguments, entry is returned as NULL
+// If there is a problem, complain, and return false
+{
+	char
+		text[MAX_STRING];
+	unsigned int
+		lineIndex,
+		textLength,
+		argumentLength,
+		argc,
+		i;
+	bool
+		unterminated;
+	char
+		*argumentText;
+
+	*entry=NULL;
+	lineIndex=0;
+	textLength=0;
+	argc=1;												// argv[0] is the program name
+	while(ParseManifestArgument(line,&lineIndex,&text[textLength],&argumentLength,&unterminated))
+	{
+		if(!strcmp(&text[textLength],"-batch"))
+		{
+			ReportComplaint(true,"Line %d of batch manifest '%s' may not use -batch\n",lineNumber,manifestName);
+			return(false);
+		}
+		textLength+=argumentLength+1;
+		argc++;
+	}
+	if(unterminated)
+	{
+		ReportComplaint(true,"Unterminated quote on line %d of batch manifest '%s'\n",lineNumber,manifestName);
+		return(false);
+	}
+	if(argc>1)
+	{
+		if(((*entry)=(BATCH_ENTRY *)NewPtr(sizeof(BATCH_ENTRY)+argc*sizeof(char *)+textLength)))
+		{
+			(*entry)->next=NULL;
+			(*entry)->lineNumber=lineNumber;
+			(*entry)->failed=false;
+			(*entry)->argc=argc;
+			argumentText=(char *)&(*entry)->argv[argc+1];
+			memcpy(argumentText,text,textLength);
+			(*entry)->argv[0]=(char *)programName;
+			for(i=1;i<argc;i++)
+			{
+				(*entry)->argv[i]=argumentText;
+				argumentText+=strlen(argumentText)+1;
+			}
+			(*entry)->argv[argc]=NULL;
+		}
+		else
+		{
+			ReportComplaint(true,"Failed to allocate batch entry\n");
+			return(false);
+		}
+	}
+	return(true);
+}
+
+static void DestroyBatchEntries(BATCH_ENTRY *entries)
+// get rid of a list of batch entries
+{
+	BATCH_ENTRY
+		*nextEntry;
+
+	while(entries)
+	{
+		nextEntry=entries->next;
+		DisposePtr(entries);
+		entries=nextEntry;
+	}
+}
+
+static bool ReadBatchManifest(const char *manifestName,BATCH_ENTRY **entries,unsigned int *numEntries)
+// Read the manifest, and make a list of the entries it contains
+// If there is a problem, complain and return false
+{
+	FILE
+		*file;
+	char
+		line[MAX_STRING];
+	unsigned int
+		lineNumber,
+		length;
+	BATCH_ENTRY
+		*lastEntry,
+		*entry;
+	bool
+		fail;
+
+	fail=false;
+	*entries=lastEntry=NULL;
+	*numEntries=0;
+	if((file=OpenFile(manifestName,"r")))
+	{
+		lineNumber=0;
+		while(!fail&&fgets(line,MAX_STRING,file))
+		{
+			lineNumber++;
+			length=strlen(line);
+			if(length&&line[length-1]=='\n')
+			{
+				line[length-1]='\0';
+			}
+			else if(!feof(file))
+			{
+				ReportComplaint(true,"Line %d of batch manifest '%s' is too long\n",lineNumber,manifestName);
+				fail=true;
+			}
+			if(!fail&&line[0]!=';')
+			{
+				if(CreateBatchEntry(manifestName,lineNumber,line,&entry))
+				{
+					if(entry)						// blank lines make no entry
+					{
+						if(lastEntry)
+						{
+							lastEntry->next=entry;
+						}
+						else
+						{
+							*entries=entry;
+						}
+						lastEntry=entry;
+						(*numEntries)++;
+					}
+				}
+				else
+				{
+					fail=true;
+				}
+			}
+		}
+		if(!fail&&ferror(file))
+		{
+			ReportComplaint(true,"Failed to read batch manifest '%s'\n",manifestName);
+			fail=true;
+		}
+		fclose(file);
+		if(fail)
+		{
+			DestroyBatchEntries(*entries);
+			*entries=NULL;
+		}
+	}
+	else
+	{
+		ReportComplaint(true,"Could not open batch manifest '%s': %s\n",manifestName,strerror(errno));
+		fail=true;
+	}
+	return(!fail);
+}
+
+static bool ReportBatchFailures(const char *manifestName,BATCH_ENTRY *entries,unsigned int numEntries)
+// complain about each entry which failed
+// return false if any did
+{
+	unsigned int
+		numFailed;
+
+	numFailed=0;
+	while(entries)
+	{
+		if(entries->failed)
+		{
+			ReportComplaint(true,"Assembly on line %d of batch manifest '%s' failed\n",entries->lineNumber,manifestName);
+			numFailed++;
+		}
+		entries=entries->next;
+	}
+	if(numFailed)
+	{
+		ReportComplaint(true,"%d of %d batch assemblies failed\n",numFailed,numEntries);
+		return(false);
+	}
+	return(true);
+}
+
+#ifdef NO_THREADS
+
+static bool RunBatchEntries(const char *manifestName,BATCH_ENTRY *entries,unsigned int numEntries,unsigned int numJobs)
+// With no threads to be had, run the entries one after another (numJobs is ignored)
+// Each starts from the state this thread had before the batch, just as a worker thread would
+// If anything fails, complain, and return false
+{
+	THREAD_STATE
+		state;
+	BATCH_ENTRY
+		*entry;
+
+	SaveThreadState(&state);
+	entry=entries;
+	while(entry)
+	{
+		RestoreThreadState(&state);
+		entry->failed=!RunAssembly(entry->argc,entry->argv);
+		entry=entry->next;
+	}
+	RestoreThreadState(&state);
+	return(ReportBatchFailures(manifestName,entries,numEntries));
+}
+
+#else
+
+struct BATCH
+{
+	pthread_mutex_t
+		mutex;								// protects nextEntry
+	BATCH_ENTRY
+		*nextEntry;							// next entry to be handed to a worker (NULL when all have been started)
+	THREAD_STATE
+		state;								// taken from the thread which started the batch, and given to each worker
+};
+
+static void *BatchWorker(void *batchPointer)
+// Keep taking entries from the batch and assembling them until there are none left
+// NOTE: this runs on its own thread, so each assembly it runs has its own state
+{
+	BATCH
+		*batch;
+	BATCH_ENTRY
+		*entry;
+
+	batch=(BATCH *)batchPointer;
+	RestoreThreadState(&batch->state);
+	do
+	{
+		pthread_mutex_lock(&batch->mutex);
+		if((entry=batch->nextEntry))
+		{
+			batch->nextEntry=entry->next;
+		}
+		pthread_mutex_unlock(&batch->mutex);
+		if(entry)
+		{
+			entry->failed=!RunAssembly(entry->argc,entry->argv);
+		}
+	} while(entry);
+	return(NULL);
+}
+
+static bool RunBatchEntries(const char *manifestName,BATCH_ENTRY *entries,unsigned int numEntries,unsigned int numJobs)
+// Run the entries on up to numJobs worker threads
+// (if numJobs is 0, run as many as there are processors)
+// If anything fails, complain, and return false
+{
+	BATCH
+		batch;
+	unsigned int
+		numWorkers,
+		i;
+	pthread_t
+		*workers;
+	bool
+		fail;
+
+	fail=false;
+	if(!numJobs)
+	{
+		numJobs=(unsigned int)Max(sysconf(_SC_NPROCESSORS_ONLN),1);
+	}
+	numJobs=Min(numJobs,numEntries);
+	if((workers=(pthread_t *)NewPtr(numJobs*sizeof(pthread_t))))
+	{
+		pthread_mutex_init(&batch.mutex,NULL);
+		batch.nextEntry=entries;
+		SaveThreadState(&batch.state);
+		numWorkers=0;
+		while(numWorkers<numJobs&&!pthread_create(&workers[numWorkers],NULL,BatchWorker,&batch))
+		{
+			numWorkers++;
+		}
+		if(numWorkers)
+		{
+			for(i=0;i<numWorkers;i++)
+			{
+				pthread_join(workers[i],NULL);
+			}
+			fail=!ReportBatchFailures(manifestName,entries,numEntries);
+		}
+		else
+		{
+			ReportComplaint(true,"Failed to start batch worker threads\n");
+			fail=true;
+		}
+		pthread_mutex_destroy(&batch.mutex);
+		DisposePtr(workers);
+	}
+	else
+	{
+		ReportComplaint(true,"Failed to allocate batch workers\n");
+		fail=true;
+	}
+	return(!fail);
+}
+
+#endif
+
+bool RunBatch(const char *manifestName,unsigned int numJobs)
+// Assemble everything listed in the manifest, running up to numJobs assemblies
+// at once (if numJobs is 0, run as many as there are processors)
+// If anything fails, complain, and return false
+{
+	BATCH_ENTRY
+		*entries;
+	unsigned int
+		numEntries;
+	bool
+		fail;
+
+	fail=false;
+	if(ReadBatchManifest(manifestName,&entries,&numEntries))
+	{
+		if(numEntries)
+		{
+			fail=!RunBatchEntries(manifestName,entries,numEntries,numJobs);
+		}
+		DestroyBatchEntries(entries);
+	}
+	else
+	{
+		fail=true;
+	}
+	return(!fail);
+}
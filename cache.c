@@ -0,0 +1,794 @@
+//	Copyright (C) 1999-2012 Core Technologies.
+//
+//	This file is part of tpasm.
+//
+//	tpasm is free software; you can redistribute it and/or modify
+//	it under the terms of the tpasm LICENSE AGREEMENT.
+//
+//	tpasm is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	tpasm LICENSE AGREEMENT for more details.
+//
+//	You should have received a copy of the tpasm LICENSE AGREEMENT
+//	along with tpasm; see the file "LICENSE.TXT".
+
+
+// Keep the results of assemblies in a cache directory, so an assembly whose
+// inputs have not changed can be restored without making a single pass.
+//
+// Each entry is named by a hash of the tpasm version, the working directory
+// and the command line (which holds the processor, defines, include paths,
+// outputs and listing). The entry records where each source was found when
+// it was looked up, and a content hash of every file the assembly read
+// (sources, includes and incbin data). If every lookup still finds the same
+// file, and every file still has the same hash, the outputs, listing and
+// messages (and dependency and warm start files) are restored from the entry.
+// The time in the first line of a restored listing is brought up to date.
+//
+// Entries are written to a temporary file, then renamed into place, so
+// assemblies sharing the cache never see a partly written one.
+// Only assemblies which succeeded with no errors are kept.
+//
+// Entry format: the CACHE_HEADER line, followed by records, each of which is
+// a line holding a tag and a length, then that many bytes, then a new line.
+
+#include	"include.h"
+#ifdef _WIN32
+#include	<process.h>
+#include	<direct.h>
+#define		getpid		_getpid
+#define		getcwd		_getcwd
+#else
+#include	<unistd.h>
+#endif
+
+#define	CACHE_HEADER		"tpasm cache 2\n"
+#define	CACHE_SUFFIX		".tpc"
+#define	DIGEST_LENGTH		32					// bytes in a SHA-256 digest
+#define	MAX_TAG				16
+
+struct SHA256_CONTEXT
+{
+	unsigned int
+		state[8];
+	unsigned long long
+		length;									// number of bytes hashed so far
+	unsigned char
+		block[64];								// partial block waiting to be hashed
+	unsigned int
+		blockLength;
+};
+
+static const unsigned int
+	sha256Constants[64]=
+	{
+		0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+		0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+		0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+		0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+		0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+		0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+		0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+		0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2,
+	};
+
+static ASSEMBLY_STATE FILE
+	*savedMessageFile,							// message file in use before the assembly started caching
+	*messageStream;								// messages are collected here while caching, so they can be kept in the entry
+
+static inline unsigned int RotateRight(unsigned int value,unsigned int bits)
+{
+	return((value>>bits)|(value<<(32-bits)));
+}
+
+static void SHA256Block(SHA256_CONTEXT *context,const unsigned char *block)
+// Hash one 64 byte block into the context
+{
+	unsigned int
+		w[64],
+		a,b,c,d,e,f,g,h,
+		t1,t2;
+	unsigned int
+		i;
+
+	for(i=0;i<16;i++)
+	{
+		w[i]=((unsigned int)block[i*4]<<24)|((unsigned int)block[i*4+1]<<16)|((unsigned int)block[i*4+2]<<8)|block[i*4+3];
+	}
+	for(;i<64;i++)
+	{
+		w[i]=w[i-16]+(RotateRight(w[i-15],7)^RotateRight(w[i-15],18)^(w[i-15]>>3))+w[i-7]+(RotateRight(w[i-2],17)^RotateRight(w[i-2],19)^(w[i-2]>>10));
+	}
+	a=context->state[0];
+	b=context->state[1];
+	c=context->state[2];
+	d=context->state[3];
+	e=context->state[4];
+	f=context->state[5];
+	g=context->state[6];
+	h=context->state[7];
+	for(i=0;i<64;i++)
+	{
+		t1=h+(RotateRight(e,6)^RotateRight(e,11)^RotateRight(e,25))+((e&f)^(~e&g))+sha256Constants[i]+w[i];
+		t2=(RotateRight(a,2)^RotateRight(a,13)^RotateRight(a,22))+((a&b)^(a&c)^(b&c));
+		h=g;
+		g=f;
+		f=e;
+		e=d+t1;
+		d=c;
+		c=b;
+		b=a;
+		a=t1+t2;
+	}
+	context->state[0]+=a;
+	context->state[1]+=b;
+	context->state[2]+=c;
+	context->state[3]+=d;
+	context->state[4]+=e;
+	context->state[5]+=f;
+	context->state[6]+=g;
+	context->state[7]+=h;
+}
+
+static void SHA256Init(SHA256_CONTEXT *context)
+// Get a context ready to hash
+{
+	context->state[0]=0x6a09e667;
+	context->state[1]=0xbb67ae85;
+	context->state[2]=0x3c6ef372;
+	context->state[3]=0xa54ff53a;
+	context->state[4]=0x510e527f;
+	context->state[5]=0x9b05688c;
+	context->state[6]=0x1f83d9ab;
+	context->state[7]=0x5be0cd19;
+	context->length=0;
+	context->blockLength=0;
+}
+
+static void SHA256Add(SHA256_CONTEXT *context,const void *data,unsigned int length)
+// Add length bytes at data to what is being hashed
+{
+	const unsigned char
+		*bytes;
+	unsigned int
+		count;
+
+	bytes=(const unsigned char *)data;
+	context->length+=length;
+	while(length)
+	{
+		if(!context->blockLength&&length>=64)
+		{
+			SHA256Block(context,bytes);		// hash whole blocks straight from the data
+			count=64;
+		}
+		else
+		{
+			count=Min(64-context->blockLength,length);
+			memcpy(&context->block[context->blockLength],bytes,count);
+			if((context->blockLength+=count)==64)
+			{
+				SHA256Block(context,context->block);
+				context->blockLength=0;
+			}
+		}
+		bytes+=count;
+		length-=count;
+	}
+}
+
+static void SHA256Finish(SHA256_CONTEXT *context,unsigned char *digest)
+// Pad out the data, and return the digest of everything added
+{
+	unsigned long long
+		bitLength;
+	unsigned char
+		lengthBytes[8];
+	unsigned int
+		i;
+
+	bitLength=context->length*8;
+	for(i=0;i<8;i++)
+	{
+		lengthBytes[i]=(unsigned char)(bitLength>>(56-i*8));
+	}
+	SHA256Add(context,"\x80",1);
+	while(context->blockLength!=56)
+	{
+		SHA256Add(context,"",1);
+	}
+	SHA256Add(context,lengthBytes,8);
+	for(i=0;i<8;i++)
+	{
+		digest[i*4]=(unsigned char)(context->state[i]>>24);
+		digest[i*4+1]=(unsigned char)(context->state[i]>>16);
+		digest[i*4+2]=(unsigned char)(context->state[i]>>8);
+		digest[i*4+3]=(unsigned char)context->state[i];
+	}
+}
+
+static void DigestToText(const unsigned char *digest,char *text)
+// Write digest out as hex (0 terminated)
+{
+	unsigned int
+		i;
+
+	for(i=0;i<DIGEST_LENGTH;i++)
+	{
+		sprintf(&text[i*2],"%02x",digest[i]);
+	}
+}
+
+static bool HashFile(const char *name,char *digestText)
+// Hash the contents of the file called name, and return the digest as hex text
+// If the file can not be read, return false
+{
+	FILE
+		*file;
+	SHA256_CONTEXT
+		context;
+	unsigned char
+		buffer[8192];
+	size_t
+		length;
+	unsigned char
+		digest[DIGEST_LENGTH];
+	bool
+		fail;
+
+	fail=false;
+	if((file=OpenFile(name,"rb")))
+	{
+		SHA256Init(&context);
+		while((length=fread(buffer,1,sizeof(buffer),file)))
+		{
+			SHA256Add(&context,buffer,length);
+		}
+		fail=(ferror(file)!=0);
+		fclose(file);
+		SHA256Finish(&context,digest);
+		DigestToText(digest,digestText);
+		return(!fail);
+	}
+	return(false);
+}
+
+static bool ReadCacheFile(FILE *file,char **buffer,unsigned int *length)
+// Read all of file into a buffer (which the caller must dispose of)
+// If there is a problem, return false
+{
+	long
+		fileLength;
+
+	if(fseek(file,0,SEEK_END)==0&&(fileLength=ftell(file))>=0&&fseek(file,0,SEEK_SET)==0)
+	{
+		if(((*buffer)=(char *)NewPtr(fileLength+1)))
+		{
+			if(fread(*buffer,1,fileLength,file)==(size_t)fileLength)
+			{
+				(*buffer)[fileLength]='\0';
+				*length=fileLength;
+				return(true);
+			}
+			DisposePtr(*buffer);
+		}
+	}
+	return(false);
+}
+
+static bool CreateCacheEntryName(const char *cacheDirectory,unsigned int argc,char *argv[],char *entryName)
+// Make the name of the cache entry for this assembly
+// If the name would be too long, return false
+{
+	SHA256_CONTEXT
+		context;
+	const char
+		*directory;
+	char
+		currentDirectory[MAX_FILE_PATH];
+	unsigned char
+		digest[DIGEST_LENGTH];
+	char
+		digestText[DIGEST_LENGTH*2+1];
+	char
+		directoryPath[MAX_FILE_PATH];
+	unsigned int
+		i;
+
+	SHA256Init(&context);
+	SHA256Add(&context,"tpasm " VERSION,strlen("tpasm " VERSION)+1);
+	if(!(directory=GetWorkingDirectory()))
+	{
+		directory=getcwd(currentDirectory,MAX_FILE_PATH)?currentDirectory:"";
+	}
+	SHA256Add(&context,directory,strlen(directory)+1);
+	for(i=1;i<argc;i++)
+	{
+		if(!strcmp(argv[i],"-cache")&&i+1<argc)
+		{
+			i++;									// where the cache is does not change the result
+		}
+		else
+		{
+			SHA256Add(&context,argv[i],strlen(argv[i])+1);
+		}
+	}
+	SHA256Finish(&context,digest);
+	DigestToText(digest,digestText);
+	return(CreateFilePath(cacheDirectory,directoryPath)&&snprintf(entryName,MAX_FILE_PATH,"%s%c%s%s",directoryPath,PATH_SEP,digestText,CACHE_SUFFIX)<MAX_FILE_PATH);
+}
+
+static bool NextCacheRecord(const char **data,const char *dataEnd,char *tag,const char **record,unsigned int *recordLength)
+// Parse the next record out of a cache entry
+// If there are no more, or the entry is damaged, return false
+{
+	unsigned int
+		tagLength;
+	const char
+		*lineEnd;
+	char
+		*numberEnd;
+
+	if((lineEnd=(const char *)memchr(*data,'\n',dataEnd-*data)))
+	{
+		tagLength=0;
+		while(&(*data)[tagLength]<lineEnd&&(*data)[tagLength]!=' '&&tagLength<MAX_TAG-1)
+		{
+			tag[tagLength]=(*data)[tagLength];
+			tagLength++;
+		}
+		tag[tagLength]='\0';
+		if((*data)[tagLength]==' ')
+		{
+			*recordLength=strtoul(&(*data)[tagLength+1],&numberEnd,10);
+			if(numberEnd==lineEnd&&*recordLength<(unsigned int)(dataEnd-lineEnd)&&lineEnd[1+*recordLength]=='\n')
+			{
+				*record=lineEnd+1;
+				*data=lineEnd+1+*recordLength+1;
+				return(true);
+			}
+		}
+	}
+	return(false);
+}
+
+static bool CacheEntryValid(const char *data,const char *dataEnd)
+// See if the inputs recorded in a cache entry are all still the same
+{
+	char
+		tag[MAX_TAG];
+	const char
+		*record;
+	unsigned int
+		recordLength;
+	char
+		recordText[1+MAX_FILE_PATH*2],
+		path[MAX_FILE_PATH];
+	char
+		digestText[DIGEST_LENGTH*2+1];
+	unsigned int
+		nameLength;
+
+	while(data<dataEnd)
+	{
+		if(!NextCacheRecord(&data,dataEnd,tag,&record,&recordLength))
+		{
+			return(false);
+		}
+		if(!strcmp(tag,"lookup")||!strcmp(tag,"file"))
+		{
+			if(recordLength>=sizeof(recordText))
+			{
+				return(false);
+			}
+			memcpy(recordText,record,recordLength);		// records are not 0 terminated in the entry
+			recordText[recordLength]='\0';
+			if(tag[0]=='l')								// lookup name, then the path it was found at
+			{
+				nameLength=strlen(recordText);
+				if(nameLength>=recordLength||!LocateSourceFile(recordText,path)||strcmp(path,&recordText[nameLength+1]))
+				{
+					return(false);
+				}
+			}
+			else										// hash of the file's contents, then its path
+			{
+				if(recordLength<=DIGEST_LENGTH*2||!HashFile(&recordText[DIGEST_LENGTH*2],digestText)||memcmp(digestText,recordText,DIGEST_LENGTH*2))
+				{
+					return(false);
+				}
+			}
+		}
+	}
+	return(true);
+}
+
+static bool WriteRestoredFile(const char *name,const char *data,unsigned int length)
+// Write data out as the file called name
+// If there is a problem, complain and return false
+{
+	FILE
+		*file;
+	bool
+		fail;
+
+	fail=false;
+	if((file=OpenBinaryOutputFile(name)))
+	{
+		fwrite(data,1,length,file);
+		fail=!CloseBinaryOutputFile(file);		// write errors are caught here
+	}
+	else
+	{
+		fail=true;
+	}
+	return(!fail);
+}
+
+static bool WriteRestoredListing(const char *name,const char *data,unsigned int length)
+// Write the listing in data out as the file called name, with its first line
+// (which says when it was assembled) made again, so it holds the time it was restored
+// If there is a problem, complain and return false
+{
+	FILE
+		*file;
+	const char
+		*lineEnd;
+	char
+		timeLine[MAX_STRING];
+	bool
+		fail;
+
+	fail=false;
+	if((file=OpenBinaryOutputFile(name)))
+	{
+		if((lineEnd=(const char *)memchr(data,'\n',length)))
+		{
+			if(lineEnd>data&&lineEnd[-1]=='\r')
+			{
+				lineEnd--;							// keep the line end the listing was written with
+			}
+			CreateListFileTimeLine(timeLine);
+			fputs(timeLine,file);
+			length-=lineEnd-data;
+			data=lineEnd;
+		}
+		fwrite(data,1,length,file);
+		fail=!CloseBinaryOutputFile(file);		// write errors are caught here
+	}
+	else
+	{
+		fail=true;
+	}
+	return(!fail);
+}
+
+static bool RestoreCacheEntry(const char *data,const char *dataEnd)
+// Write out every output and the listing kept in the entry, and repeat its messages
+// If there is a problem, complain and return false
+{
+	char
+		tag[MAX_TAG];
+	const char
+		*record;
+	unsigned int
+		recordLength;
+	unsigned int
+		outputIndex;
+	const char
+		*outputName;
+	bool
+		fail;
+
+	fail=false;
+	outputIndex=0;
+	while(!fail&&data<dataEnd&&NextCacheRecord(&data,dataEnd,tag,&record,&recordLength))
+	{
+		if(!strcmp(tag,"output"))
+		{
+			if((outputName=GetOutputFileName(outputIndex++)))
+			{
+				fail=!WriteRestoredFile(outputName,record,recordLength);
+			}
+		}
+		else if(!strcmp(tag,"listing"))
+		{
+			if(listFileName)
+			{
+				fail=!WriteRestoredListing(listFileName,record,recordLength);
+			}
+		}
+		else if(!strcmp(tag,"dependencies"))
+		{
+			if(dependencyFileName)
+			{
+				fail=!WriteRestoredFile(dependencyFileName,record,recordLength);
+			}
+		}
+		else if(!strcmp(tag,"seeds"))
+		{
+			if(warmStartFileName)
+			{
+				fail=!WriteRestoredFile(warmStartFileName,record,recordLength);
+			}
+		}
+		else if(!strcmp(tag,"messages"))
+		{
+			fwrite(record,1,recordLength,GetMessageFile());
+		}
+	}
+	return(!fail);
+}
+
+static bool RestoreCachedAssembly(const char *entryName,bool *restored)
+// If there is a cache entry for this assembly, and its inputs have not changed,
+// restore it, and set restored
+// If there is a problem restoring it, complain and return false
+{
+	FILE
+		*file;
+	char
+		*entry;
+	unsigned int
+		entryLength;
+	const char
+		*data,
+		*dataEnd;
+	bool
+		fail;
+
+	fail=false;
+	*restored=false;
+	if((file=fopen(entryName,"rb")))
+	{
+		if(ReadCacheFile(file,&entry,&entryLength))
+		{
+			data=entry;
+			dataEnd=entry+entryLength;
+			if(entryLength>=strlen(CACHE_HEADER)&&!memcmp(data,CACHE_HEADER,strlen(CACHE_HEADER)))
+			{
+				data+=strlen(CACHE_HEADER);
+				if(CacheEntryValid(data,dataEnd))
+				{
+					ReportDiagnostic("Restoring assembly from cache entry '%s'\n",entryName);
+					fail=!RestoreCacheEntry(data,dataEnd);
+					*restored=true;
+				}
+			}
+			DisposePtr(entry);
+		}
+		fclose(file);
+	}
+	return(!fail);
+}
+
+static bool WriteCacheRecord(FILE *file,const char *tag,const void *data,unsigned int length)
+// Write one record to a cache entry
+// If there is a problem, return false
+{
+	return(fprintf(file,"%s %u\n",tag,length)>0&&fwrite(data,1,length,file)==length&&putc('\n',file)!=EOF);
+}
+
+static bool WriteCacheFileRecord(FILE *entryFile,const char *tag,FILE *file)
+// Write all of file as a record of a cache entry
+// If there is a problem, return false
+{
+	char
+		*buffer;
+	unsigned int
+		length;
+	bool
+		fail;
+
+	fail=true;
+	if(ReadCacheFile(file,&buffer,&length))
+	{
+		fail=!WriteCacheRecord(entryFile,tag,buffer,length);
+		DisposePtr(buffer);
+	}
+	return(!fail);
+}
+
+static bool WriteCacheOutputRecord(FILE *entryFile,const char *tag,const char *name)
+// Write the output file called name as a record of a cache entry
+// If there is a problem, return false
+{
+	FILE
+		*file;
+	bool
+		fail;
+
+	fail=true;
+	if((file=OpenFile(name,"rb")))
+	{
+		fail=!WriteCacheFileRecord(entryFile,tag,file);
+		fclose(file);
+	}
+	return(!fail);
+}
+
+static bool WriteCacheEntry(FILE *entryFile)
+// Write everything needed to check and restore this assembly to entryFile
+// If there is a problem, return false
+{
+	SYM_TABLE_NODE
+		*lookupNode,
+		*fileNameSymbol;
+	const char
+		*lookupName,
+		*fileName,
+		*outputName;
+	char
+		record[1+MAX_FILE_PATH*2];
+	unsigned int
+		recordLength,
+		i;
+	bool
+		fail;
+
+	fail=(fputs(CACHE_HEADER,entryFile)==EOF);
+	lookupNode=NULL;
+	while(!fail&&(lookupNode=NextSourceFileLookup(lookupNode,&lookupName,&fileNameSymbol)))
+	{
+		if(fileNameSymbol)								// lookups which found nothing would have failed the assembly
+		{
+			recordLength=snprintf(record,sizeof(record),"%s%c%s",lookupName,'\0',STNodeName(fileNameSymbol));
+			fail=(recordLength>=sizeof(record))||!WriteCacheRecord(entryFile,"lookup",record,recordLength);
+		}
+	}
+	fileNameSymbol=NULL;
+	while(!fail&&(fileNameSymbol=NextFileNameSymbol(fileNameSymbol,&fileName)))
+	{
+		if(HashFile(fileName,record))
+		{
+			recordLength=snprintf(&record[DIGEST_LENGTH*2],sizeof(record)-DIGEST_LENGTH*2,"%s",fileName)+DIGEST_LENGTH*2;
+			fail=(recordLength>=sizeof(record))||!WriteCacheRecord(entryFile,"file",record,recordLength);
+		}
+		else
+		{
+			fail=true;
+		}
+	}
+	if(!fail)
+	{
+		fail=!WriteCacheFileRecord(entryFile,"messages",messageStream);
+	}
+	for(i=0;!fail&&(outputName=GetOutputFileName(i));i++)
+	{
+		fail=!WriteCacheOutputRecord(entryFile,"output",outputName);
+	}
+	if(!fail&&listFileName)
+	{
+		fail=!WriteCacheOutputRecord(entryFile,"listing",listFileName);
+	}
+	if(!fail&&dependencyFileName)
+	{
+		fail=!WriteCacheOutputRecord(entryFile,"dependencies",dependencyFileName);
+	}
+	if(!fail&&warmStartFileName)
+	{
+		fail=!WriteCacheOutputRecord(entryFile,"seeds",warmStartFileName);
+	}
+	return(!fail);
+}
+
+static void StoreCachedAssembly(const char *entryName)
+// Keep the results of the assembly just completed in the cache
+// Failing to do this only makes a warning, since the assembly itself is fine
+{
+	char
+		tempName[MAX_FILE_PATH];
+	FILE
+		*file;
+	bool
+		fail;
+
+	fail=false;
+	if(snprintf(tempName,MAX_FILE_PATH,"%s.%d.%p",entryName,(int)getpid(),(void *)&messageStream)<MAX_FILE_PATH)	// the address of thread local data tells threads apart
+	{
+		if((file=fopen(tempName,"wb")))
+		{
+			fail=!WriteCacheEntry(file);
+			fail=(fclose(file)!=0)||fail;
+			if(fail||rename(tempName,entryName))
+			{
+				remove(tempName);
+				fail=true;
+			}
+		}
+		else
+		{
+			fail=true;
+		}
+	}
+	else
+	{
+		fail=true;
+	}
+	if(fail)
+	{
+		ReportComplaint(false,"Could not store assembly in cache entry '%s'\n",entryName);
+	}
+}
+
+static bool StartCachingAssembly()
+// Collect the messages made by the assembly, so they can be kept in the cache entry
+// If there is a problem, complain and return false
+{
+	if((messageStream=tmpfile()))
+	{
+		savedMessageFile=GetMessageFile();
+		SetMessageFile(messageStream);
+		return(true);
+	}
+	ReportComplaint(true,"Failed to create cache message file\nOS Reports: %s\n",strerror(errno));
+	return(false);
+}
+
+static void FinishCachingAssembly(const char *entryName,bool succeeded)
+// Pass the collected messages on to where they would have gone, and
+// if the assembly succeeded with no errors, keep its results in the cache
+{
+	char
+		buffer[MAX_STRING];
+	size_t
+		length;
+
+	SetMessageFile(savedMessageFile);
+	fflush(messageStream);
+	rewind(messageStream);
+	while((length=fread(buffer,1,sizeof(buffer),messageStream)))
+	{
+		fwrite(buffer,1,length,savedMessageFile);
+	}
+	if(succeeded&&!errorCount)
+	{
+		StoreCachedAssembly(entryName);
+	}
+	fclose(messageStream);
+	messageStream=NULL;
+}
+
+bool RunCachedAssembly(const char *cacheDirectory,unsigned int argc,char *argv[])
+// Restore the assembly described by argv from cacheDirectory if it can be,
+// otherwise assemble, and keep the results in cacheDirectory
+// If there is a problem, complain and return false
+{
+	char
+		entryName[MAX_FILE_PATH];
+	bool
+		restored;
+	bool
+		fail;
+
+	fail=false;
+	if(CreateCacheEntryName(cacheDirectory,argc,argv,entryName))
+	{
+		if(RestoreCachedAssembly(entryName,&restored))
+		{
+			if(!restored)
+			{
+				if(StartCachingAssembly())
+				{
+					fail=!HandleAssembly();
+					FinishCachingAssembly(entryName,!fail);
+				}
+				else
+				{
+					fail=true;
+				}
+			}
+		}
+		else
+		{
+			fail=true;
+		}
+	}
+	else
+	{
+		ReportComplaint(true,"Cache directory name '%s' is too long\n",cacheDirectory);
+		fail=true;
+	}
+	return(!fail);
+}
@@ -18,14 +18,33 @@
 
 #include	"include.h"
 
+static ASSEMBLY_STATE CONTEXT_RECORD
+	*freeContexts;						// records which have been popped, kept to be pushed again (they belong to the pass arena)
+
 bool PushContextRecord(unsigned int contextBytes)
 // Create a new context record, push it onto the stack
+// A popped record which can hold contextBytes is used again if there is one,
+// otherwise a new one is taken from the pass arena
 // If there was a problem, return false
 {
 	CONTEXT_RECORD
-		*record;
+		*record,
+		**previous;
 
-	if((record=(CONTEXT_RECORD *)NewPtr(sizeof(CONTEXT_RECORD)+contextBytes)))
+	previous=&freeContexts;
+	while((record=*previous)&&record->contextBytes<contextBytes)
+	{
+		previous=&record->next;
+	}
+	if(record)
+	{
+		*previous=record->next;
+	}
+	else if((record=(CONTEXT_RECORD *)ArenaNewPtr(passArena,sizeof(CONTEXT_RECORD)+contextBytes)))
+	{
+		record->contextBytes=contextBytes;
+	}
+	if(record)
 	{
 		record->contextType=0;
 		record->active=false;
@@ -40,7 +59,7 @@ bool PushContextRecord(unsigned int contextBytes)
 }
 
 void PopContextRecord(void)
-// Pull a context record off the stack and destroy it
+// Pull a context record off the stack, and keep it to be pushed again
 // NOTE: if the stack is empty, do nothing
 {
 	CONTEXT_RECORD
@@ -49,7 +68,8 @@ void PopContextRecord(void)
 	if(contextStack)
 	{
 		tempRecord=contextStack->next;
-		DisposePtr(contextStack);
+		contextStack->next=freeContexts;
+		freeContexts=contextStack;
 		contextStack=tempRecord;
 	}
 }
@@ -88,4 +108,5 @@ void FlushContextRecords()
 		}
 		PopContextRecord();
 	}
+	freeContexts=NULL;									// the pass arena is about to be reset, taking the kept records with it
 }
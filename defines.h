@@ -17,19 +17,45 @@
 #define		VERSION					"1.12"
 
 #define		DEFAULT_MAX_PASSES		32			// default maximum number of passes made by the assembler
+#define		DEFAULT_RECORD_LENGTH	16			// default number of data bytes in each hex or S-record
 
 #define		MAX_INCLUDE_DEPTH		256
 #define		MAX_BLOCK_DEPTH			256			// number of levels of text substitution allowed
 #define		MAX_STRING				4096		// maximum string length (including 0 termination)
 #define		MAX_FILE_PATH			4096		// maximum length of a path (including 0 termination)
+#define		PATH_SEP				'/'			// path separation character (change this for your OS if needed)
 
 #define		Max(a,b) 	((a)>(b)?(a):(b))
 #define		Min(a,b) 	((a)<(b)?(a):(b))
 
 #define	elementsof(array) (sizeof(array)/sizeof(array[0]))
 
+// Everything which changes during an assembly is declared ASSEMBLY_STATE, which gives
+// each thread its own copy, so separate threads can run separate assemblies at the same time.
+// Tables which are only read (opcode lists, the processor families and output file types) are shared.
+// NOTE: since the state belongs to the thread, a thread can only run one assembly at a time,
+// and a thread which helps with an assembly must first be given its state (see THREAD_STATE)
+// DOS has no threads, so there each batch entry and output file is handled in turn
+#ifdef __DJGPP__
+#define		NO_THREADS
+#endif
+
+// The assembly server (--serve) needs threads and Unix domain sockets
+#if defined(NO_THREADS)||defined(_WIN32)
+#define		NO_SERVER
+#endif
+
+#if defined(NO_THREADS)
+#define		ASSEMBLY_STATE
+#elif defined(_MSC_VER)
+#define		ASSEMBLY_STATE			__declspec(thread)
+#else
+#define		ASSEMBLY_STATE			__thread
+#endif
+
 struct SYM_TABLE_NODE;							// opaque symbol table node
 struct SYM_TABLE;								// opaque symbol table
+struct MEMORY_ARENA;							// opaque memory arena
 
 struct WHERE_FROM
 {
@@ -45,6 +71,8 @@ struct TEXT_LINE
 		*next;									// points to the next line of the text (NULL if this is the last line)
 	WHERE_FROM
 		whereFrom;								// tells where this line came from in the source data
+	unsigned int
+		lineClass;								// size class of the record, so it can be used again once the line is destroyed (see macro.c)
 	char
 		line[1];								// stored line data, 0 terminated
 };
@@ -56,6 +84,28 @@ struct TEXT_BLOCK
 		*lastLine;
 };
 
+// source line flags (used in structure below)
+
+#define		SLF_OVERFLOW			0x01		// line was too long when read, and was truncated
+#define		SLF_BLANK				0x02		// line contains nothing but white space and/or a comment
+
+struct SOURCE_LINE
+{
+	SOURCE_LINE
+		*next;									// points to the next line of the file (NULL if this is the last line)
+	unsigned int
+		flags;									// information worked out about the line when it was read
+	char
+		line[1];								// stored line data, 0 terminated
+};
+
+struct SOURCE_FILE								// lines of a source file, read once and replayed on every pass
+{
+	SOURCE_LINE
+		*firstLine,								// pointers to lines of the file (NULL if no lines)
+		*lastLine;
+};
+
 // label flags (used in structure below)
 
 enum
@@ -82,17 +132,34 @@ struct LABEL_RECORD
 		type;									// flags what type of label this is
 	unsigned int
 		passCount;								// passcount when last defined
+	unsigned int
+		readPassCount;							// passcount when the value was last read by an expression
 	bool
 		resolved;								// tells if this label has been resolved or not
 	unsigned int
 		refCount;								// tells how many places in the source this label was referenced
-	LABEL_RECORD
-		*previous,
-		*next;
+	unsigned int
+		id;										// dense number given to the label when it was created (see LABEL_TABLE)
 	WHERE_FROM
 		whereFrom;								// tells where this label was defined (first)
 	SYM_TABLE_NODE
-		*symbol;								// label name is stored here
+		*symbol;								// label name is stored here (NULL once the label has been destroyed)
+	LABEL_RECORD
+		*nextFree;								// next destroyed label whose record can be given out again (see LABEL_TABLE)
+};
+
+#define		LABEL_BLOCK_SIZE		256			// number of labels kept together in each block of the label table
+
+struct LABEL_TABLE								// every label of an assembly, kept in blocks which never move, and indexed by id
+{
+	LABEL_RECORD
+		**blocks;								// blocks of LABEL_BLOCK_SIZE labels
+	unsigned int
+		maxBlocks,								// number of block pointers blocks has room for
+		numIDs,									// number of ids handed out (including those of labels which were destroyed)
+		numLabels;								// number of labels which currently exist
+	LABEL_RECORD
+		*freeLabels;							// records of destroyed labels, which are given out again (with their ids) before new ones are made
 };
 
 struct LISTING_RECORD							// used to create and control the listing
@@ -107,6 +174,12 @@ struct LISTING_RECORD							// used to create and control the listing
 		wantList;
 	char
 		listObjectString[MAX_STRING];			// object code string printed out
+	bool
+		listObjectWords;						// true if listObjectBytes holds 16 bit words (high byte first) instead of bytes
+	unsigned int
+		numListObjectBytes;						// number of bytes held in listObjectBytes
+	unsigned char
+		listObjectBytes[(MAX_STRING/5)*2];		// object code for the line, only formatted into listObjectString when the line is listed (as many words as that can hold)
 };
 
 enum
@@ -132,6 +205,8 @@ struct CONTEXT_RECORD
 		whereFrom;								// tells where the context was started
 	CONTEXT_FLUSH
 		*flush;									// routine used to flush this record before it is deleted (NULL if no routine)
+	unsigned int
+		contextBytes;							// number of bytes contextData can hold
 	unsigned char
 		contextData[1];							// variable length array of context data
 };
@@ -211,6 +286,11 @@ struct SEGMENT_RECORD
 	CODE_PAGE
 		*pageCache,								// points to the last used page to make things more efficient
 		*firstPage;								// points to the first page of the segment (pages are linked in order here)
+	CODE_PAGE
+		**pageIndex;							// array of pointers to the pages of the segment, sorted by address (NULL if no pages)
+	unsigned int
+		numPages,								// number of pages in the index
+		maxPages;								// number of pages the index has room for
 	unsigned int
 		currentPC;								// keeps track of the running byte location within the segment
 	unsigned int
@@ -227,3 +307,52 @@ struct SEGMENT_RECORD
 		*symbol;								// segment name is stored here
 };
 
+typedef void SEGMENT_DUMP_RECORD(FILE *file,unsigned int address,const unsigned char *bytes,unsigned int numBytes);	// called by DumpSegmentRecords with each record of a segment
+
+// message types (passed to MESSAGE_CAPTURE functions)
+
+enum
+{
+	MT_ERROR,
+	MT_WARNING,
+	MT_SUPPLEMENT,								// more information about the previous error or warning
+	MT_INDIRECT,								// where the previous message was generated from, when it came out of a macro, repeat, etc...
+};
+
+// Hooks which let a program that embeds the assembler hand it source from memory, and
+// take its messages and results directly instead of through files and stderr.
+// Each is set for the current thread, and stays set across assemblies until changed.
+
+typedef bool SOURCE_PROVIDER(void *providerData,const char *name,const char **text,unsigned int *textLength);	// return true with the text for name if it is held, false to look in the file system
+typedef void SOURCE_RELEASE(void *providerData,const char *text);	// called when text handed over by a SOURCE_PROVIDER is no longer needed
+typedef void MESSAGE_CAPTURE(void *captureData,unsigned int messageType,const char *fileName,unsigned int lineNumber,const char *message);	// fileName is NULL for messages not tied to a source line
+typedef bool OUTPUT_COLLECTOR(void *collectorData);	// called while segments and labels of the final pass still exist, return false on hard failure
+
+struct THREAD_STATE								// the parts of a thread's assembly state which are handed to the threads it starts (see SaveThreadState)
+{
+	const char
+		*workingDirectory;
+	FILE
+		*messageFile;
+	SOURCE_PROVIDER
+		*sourceProvider;
+	SOURCE_RELEASE
+		*sourceRelease;
+	void
+		*sourceProviderData;
+	const char
+		*sourceFileName;
+	SEGMENT_RECORD
+		*segmentsHead;
+	LABEL_TABLE
+		labelTable;
+	unsigned char
+		binaryFill;
+	bool
+		binaryWindow;
+	unsigned int
+		binaryWindowStart,
+		binaryWindowEnd,
+		hexRecordLength;
+};
+
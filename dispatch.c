@@ -0,0 +1,146 @@
+//	Copyright (C) 1999-2012 Core Technologies.
+//
+//	This file is part of tpasm.
+//
+//	tpasm is free software; you can redistribute it and/or modify
+//	it under the terms of the tpasm LICENSE AGREEMENT.
+//
+//	tpasm is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	tpasm LICENSE AGREEMENT for more details.
+//
+//	You should have received a copy of the tpasm LICENSE AGREEMENT
+//	along with tpasm; see the file "LICENSE.TXT".
+
+
+// Remember what each name found at the start of a line turned out to be
+// (global pseudo-op, processor pseudo-op, opcode, or something else), so later
+// lines with the same name can go straight to the right handler with one lookup.
+// Each processor has its own table, since its pseudo-ops and opcodes differ.
+// The processor families keep their own opcode tables, so a name is only placed
+// into one of their categories after the family has first matched it.
+
+#include	"include.h"
+
+struct MNEMONIC_TABLE
+{
+	MNEMONIC_TABLE
+		*next;									// next table (NULL if none)
+	PROCESSOR
+		*processor;								// processor the table is for (NULL when no processor is selected)
+	SYM_TABLE
+		*symbols;								// MNEMONIC records by name (looked up ignoring case)
+};
+
+static ASSEMBLY_STATE MNEMONIC_TABLE
+	*mnemonicTables,							// tables made so far in this assembly (in the build arena)
+	*currentMnemonicTable;						// table for the current processor
+static ASSEMBLY_STATE unsigned int
+	macroGeneration;							// bumped whenever a macro is created or destroyed
+
+MACRO_RECORD *MatchMnemonicMacro(MNEMONIC *mnemonic,const char *name)
+// Return the macro called name (which is the name of mnemonic), or NULL if there is none
+// The answer is kept in mnemonic until the macros change
+{
+	if(mnemonic->macroGeneration!=macroGeneration)
+	{
+		mnemonic->macro=MatchMacro(name);
+		mnemonic->macroGeneration=macroGeneration;
+	}
+	return(mnemonic->macro);
+}
+
+bool LookupMnemonic(const char *name,MNEMONIC **mnemonic)
+// Find what is known about name for the current processor, adding it to the
+// table the first time it is seen
+// If there is a problem, complain and return false
+{
+	if(!((*mnemonic)=(MNEMONIC *)STFindDataForNameNoCase(currentMnemonicTable->symbols,name)))
+	{
+		if(((*mnemonic)=(MNEMONIC *)ArenaNewPtr(buildArena,sizeof(MNEMONIC))))
+		{
+			if(((*mnemonic)->pseudoOpcode=MatchGlobalPseudoOpcode(name)))	// global pseudo-ops come before anything of the processor
+			{
+				(*mnemonic)->type=MN_GLOBAL_PSEUDO;
+			}
+			else
+			{
+				(*mnemonic)->type=MN_UNKNOWN;
+			}
+			(*mnemonic)->macro=NULL;
+			(*mnemonic)->macroGeneration=macroGeneration-1;
+			if(STAddEntryAtEnd(currentMnemonicTable->symbols,name,*mnemonic))
+			{
+				return(true);
+			}
+		}
+		ReportComplaint(true,"Failed to create mnemonic table entry (Out of memory)\n");
+		return(false);
+	}
+	return(true);
+}
+
+void MacrosChanged()
+// A macro has been created or destroyed, so forget the macros remembered for all names
+{
+	macroGeneration++;
+}
+
+bool SelectMnemonicTable(PROCESSOR *processor)
+// processor is being selected (it may be NULL), so switch to its table,
+// making it if this is the first time it has been selected
+// If there is a problem, complain and return false
+{
+	MNEMONIC_TABLE
+		*table;
+
+	table=mnemonicTables;
+	while(table&&table->processor!=processor)
+	{
+		table=table->next;
+	}
+	if(!table)
+	{
+		if((table=(MNEMONIC_TABLE *)ArenaNewPtr(buildArena,sizeof(MNEMONIC_TABLE))))
+		{
+			if((table->symbols=STNewArenaSymbolTable(0,buildArena)))
+			{
+				table->processor=processor;
+				table->next=mnemonicTables;
+				mnemonicTables=table;
+			}
+			else
+			{
+				table=NULL;
+			}
+		}
+		if(!table)
+		{
+			ReportComplaint(true,"Failed to create mnemonic table (Out of memory)\n");
+			return(false);
+		}
+	}
+	currentMnemonicTable=table;
+	return(true);
+}
+
+void UnInitMnemonics()
+// undo what InitMnemonics did
+{
+	while(mnemonicTables)
+	{
+		STDisposeSymbolTable(mnemonicTables->symbols);
+		mnemonicTables=mnemonicTables->next;
+	}
+	currentMnemonicTable=NULL;
+}
+
+bool InitMnemonics()
+// initialize mnemonic tables (they are made as processors are selected)
+{
+	mnemonicTables=NULL;
+	currentMnemonicTable=NULL;
+	macroGeneration=0;
+	return(true);
+}
@@ -0,0 +1,45 @@
+//	Copyright (C) 1999-2012 Core Technologies.
+//
+//	This file is part of tpasm.
+//
+//	tpasm is free software; you can redistribute it and/or modify
+//	it under the terms of the tpasm LICENSE AGREEMENT.
+//
+//	tpasm is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	tpasm LICENSE AGREEMENT for more details.
+//
+//	You should have received a copy of the tpasm LICENSE AGREEMENT
+//	along with tpasm; see the file "LICENSE.TXT".
+
+
+// mnemonic types (see MNEMONIC)
+
+enum
+{
+	MN_UNKNOWN,									// not known yet to be anything but a global pseudo-op (the processor has not been asked)
+	MN_GLOBAL_PSEUDO,							// global pseudo-op
+	MN_PROCESSOR_PSEUDO,						// pseudo-op of the processor
+	MN_OPCODE,									// opcode of the processor
+	MN_OTHER,									// none of the above (so possibly a macro)
+};
+
+struct MNEMONIC									// what a name at the start of a line turned out to be for one processor
+{
+	unsigned int
+		type;									// one of MN_...
+	PSEUDO_OPCODE
+		*pseudoOpcode;							// global pseudo-op to call (if type is MN_GLOBAL_PSEUDO)
+	MACRO_RECORD
+		*macro;									// macro with the name (NULL if none), valid only if macroGeneration matches
+	unsigned int
+		macroGeneration;
+};
+
+MACRO_RECORD *MatchMnemonicMacro(MNEMONIC *mnemonic,const char *name);
+bool LookupMnemonic(const char *name,MNEMONIC **mnemonic);
+void MacrosChanged();
+bool SelectMnemonicTable(PROCESSOR *processor);
+void UnInitMnemonics();
+bool InitMnemonics();
@@ -25,6 +25,32 @@
 
 #include	"include.h"
 
+#define	MAX_MEMO_LABELS		8			// most constants an expression may use and still be memoized
+
+struct EXPRESSION_MEMO					// remembers the value of an expression which depends only on constants
+{
+	int
+		value;
+	unsigned int
+		length;							// number of characters of the line the expression was parsed from
+	unsigned int
+		numLabels;						// constants the value was worked out from, and the values they had
+	LABEL_RECORD
+		*labels[MAX_MEMO_LABELS];
+	int
+		labelValues[MAX_MEMO_LABELS];
+};
+
+static ASSEMBLY_STATE SYM_TABLE
+	*expressionMemos;					// memoized expressions, keyed by the text of the line from the start of the expression
+
+static ASSEMBLY_STATE bool
+	canMemoize;							// cleared while evaluating an expression if it uses anything which may change
+static ASSEMBLY_STATE unsigned int
+	numMemoLabels;						// constants used so far by the expression being evaluated
+static ASSEMBLY_STATE LABEL_RECORD
+	*memoLabels[MAX_MEMO_LABELS];
+
 struct OPERATOR_DESCRIPTION				// tells how each operator is defined
 {
 	unsigned int
@@ -178,6 +204,7 @@ static bool ParseExpressionConstant(const char *line,unsigned int *lineIndex,EXP
 		case '$':						// this means the current PC (one $ is current, $$ is current ignoring any relative origin)
 			(*lineIndex)++;
 			element->type=ET_NUM;
+			canMemoize=false;			// the PC changes from line to line
 			if(line[*lineIndex]=='$')
 			{
 				(*lineIndex)++;
@@ -540,18 +567,30 @@ static bool Factor(const char *line,unsigned int *lineIndex,EXPRESSION_ELEMENT *
 			}
 			else										// must be a label, or local label
 			{
-				if((oldLabel=LocateLabel(&element->string[0],!intermediatePass))&&oldLabel->resolved)
+				if((oldLabel=ReadLabel(&element->string[0],!intermediatePass))&&oldLabel->resolved)
 				{
 					// @@@ handle "string" labels
 					expressionListItem->itemType=ELI_INTEGER;
 					expressionListItem->itemValue=oldLabel->value;
 					expressionListItem->valueResolved=true;
+					if(canMemoize)
+					{
+						if(element->type==ET_LABEL&&numMemoLabels<MAX_MEMO_LABELS&&IsConstantLabel(oldLabel))
+						{
+							memoLabels[numMemoLabels++]=oldLabel;
+						}
+						else
+						{
+							canMemoize=false;	// local names depend on the scope, and other labels move
+						}
+					}
 				}
 				else
 				{
 					expressionListItem->itemType=ELI_UNRESOLVED;
 					expressionListItem->itemValue=0;
 					expressionListItem->valueResolved=false;
+					canMemoize=false;			// binary operators may still hand back a resolved value
 					numUnresolvedLabels++;
 					AssemblyComplaint(NULL,true,"Failed to resolve '%s'\n",element->string);
 					ReportDiagnostic("Unresolved label: '%s'\n",element->string);
@@ -632,6 +671,7 @@ static bool ProcessBinaryOperator(const char *line,unsigned int *lineIndex,EXPRE
 							if(tmpExpressionListItem.itemValue<0)
 							{
 								AssemblyComplaint(NULL,false,"Shift by negative value\n");
+								canMemoize=false;			// so the warning is given every time
 							}
 							break;
 						case OP_SHIFT_RIGHT:
@@ -639,6 +679,7 @@ static bool ProcessBinaryOperator(const char *line,unsigned int *lineIndex,EXPRE
 							if(tmpExpressionListItem.itemValue<0)
 							{
 								AssemblyComplaint(NULL,false,"Shift by negative value\n");
+								canMemoize=false;
 							}
 							break;
 
@@ -751,6 +792,76 @@ static bool ParentheticExpression(const char *line,unsigned int *lineIndex,EXPRE
 	return(!fail);
 }
 
+static bool RecallExpression(const char *line,unsigned int *lineIndex,EXPRESSION_LIST_ITEM *expressionListItem)
+// If the expression at lineIndex has been memoized, and the constants it used still have
+// the values they had, return its value, push lineIndex past it, and return true
+// NOTE: the constants are treated as though they were read again
+{
+	EXPRESSION_MEMO
+		*memo;
+	unsigned int
+		i;
+
+	if((memo=(EXPRESSION_MEMO *)STFindDataForName(expressionMemos,&line[*lineIndex])))
+	{
+		for(i=0;i<memo->numLabels;i++)
+		{
+			if(!memo->labels[i]->resolved||memo->labels[i]->value!=memo->labelValues[i])
+			{
+				return(false);							// a constant changed between passes
+			}
+		}
+		for(i=0;i<memo->numLabels;i++)
+		{
+			memo->labels[i]->readPassCount=passCount;
+			if(!intermediatePass)
+			{
+				memo->labels[i]->refCount++;
+			}
+		}
+		expressionListItem->itemType=ELI_INTEGER;
+		expressionListItem->itemValue=memo->value;
+		expressionListItem->valueResolved=true;
+		*lineIndex+=memo->length;
+		return(true);
+	}
+	return(false);
+}
+
+static void MemoizeExpression(const char *line,unsigned int startIndex,unsigned int endIndex,int value)
+// Remember value for the expression which was parsed from line between startIndex and endIndex,
+// along with the constants (in memoLabels) it was worked out from
+// NOTE: if the memo cannot be made, nothing is remembered
+{
+	EXPRESSION_MEMO
+		*memo;
+	unsigned int
+		i;
+
+	if(!(memo=(EXPRESSION_MEMO *)STFindDataForName(expressionMemos,&line[startIndex])))
+	{
+		if((memo=(EXPRESSION_MEMO *)ArenaNewPtr(buildArena,sizeof(EXPRESSION_MEMO))))
+		{
+			if(!STAddEntryAtEnd(expressionMemos,&line[startIndex],memo))
+			{
+				return;
+			}
+		}
+		else
+		{
+			return;
+		}
+	}
+	memo->value=value;
+	memo->length=endIndex-startIndex;
+	memo->numLabels=numMemoLabels;
+	for(i=0;i<numMemoLabels;i++)
+	{
+		memo->labels[i]=memoLabels[i];
+		memo->labelValues[i]=memoLabels[i]->value;
+	}
+}
+
 bool ParseTypedExpression(const char *line,unsigned int *lineIndex,EXPRESSION_LIST_ITEM *expressionListItem)
 // Parse an expression from line, return the resulting expressionList
 // item.
@@ -763,6 +874,8 @@ bool ParseTypedExpression(const char *line,unsigned int *lineIndex,EXPRESSION_LI
 // In other words, this function should not be called to test to see
 // if the next thing is an expression, since it may output spurious
 // error/warning messages.
+// NOTE: integer expressions made only of numbers and constants are memoized
+// the first time they are worked out, so they are not parsed again
 {
 	bool
 		haveElement;
@@ -770,10 +883,20 @@ bool ParseTypedExpression(const char *line,unsigned int *lineIndex,EXPRESSION_LI
 		element;
 	bool
 		fail;
+	unsigned int
+		startIndex;
+
+	if(RecallExpression(line,lineIndex,expressionListItem))
+	{
+		return(true);
+	}
 
 	fail=false;
 	expressionListItem->itemType=ELI_UNRESOLVED;		// don't know what this is yet
 	expressionListItem->valueResolved=false;			// not resolved either
+	startIndex=*lineIndex;
+	canMemoize=true;
+	numMemoLabels=0;
 
 	if((haveElement=ParseExpressionElement(line,lineIndex,&element)))	// get the first element of the expression (if there is one)
 	{
@@ -802,6 +925,10 @@ bool ParseTypedExpression(const char *line,unsigned int *lineIndex,EXPRESSION_LI
 				}
 				fail=true;
 			}
+			else if(canMemoize&&expressionListItem->itemType==ELI_INTEGER&&expressionListItem->valueResolved)
+			{
+				MemoizeExpression(line,startIndex,*lineIndex,expressionListItem->itemValue);
+			}
 		}
 		else
 		{
@@ -868,3 +995,19 @@ bool ParseExpression(const char *line,unsigned int *lineIndex,int *value,bool *u
 	}
 	return(!fail);
 }
+
+void UnInitExpressions()
+// undo what InitExpressions did
+{
+	STDisposeSymbolTable(expressionMemos);
+}
+
+bool InitExpressions()
+// make the table of memoized expressions
+{
+	if((expressionMemos=STNewArenaSymbolTable(0,buildArena)))
+	{
+		return(true);
+	}
+	return(false);
+}
@@ -20,3 +20,5 @@ struct EXPRESSION_LIST_ITEM
 
 bool ParseTypedExpression(const char *line,unsigned int *lineIndex,EXPRESSION_LIST_ITEM *expressionListItem);
 bool ParseExpression(const char *line,unsigned int *lineIndex,int *value,bool *unresolved);
+void UnInitExpressions();
+bool InitExpressions();
@@ -16,8 +16,13 @@
 // File handling
 
 #include	"include.h"
-
-#define		PATH_SEP	'/'		// path separation character (change this for your OS if needed)
+#include	<sys/stat.h>
+#ifdef _WIN32
+#include	<process.h>
+#define		getpid		_getpid
+#else
+#include	<unistd.h>
+#endif
 
 struct PATH_HEADER
 {
@@ -27,50 +32,324 @@ struct PATH_HEADER
 		pathName[1];			// variable length path name
 };
 
-static PATH_HEADER
+struct FILE_LOOKUP				// remembers how a source file name (as given to OpenSourceFile) was resolved
+{
+	SYM_TABLE_NODE
+		*fileNameSymbol;		// file the name was found as (NULL if it could not be opened)
+	int
+		openError;				// errno from the failed open if fileNameSymbol is NULL
+};
+
+struct OUTPUT_FILE				// an output file which is open for writing
+{
+	OUTPUT_FILE
+		*nextFile;
+	FILE
+		*file;
+	bool
+		replace;				// set if the output is written to tempPath, then renamed over path (otherwise it is written straight to path)
+	char
+		path[MAX_FILE_PATH],	// where the output ends up (with any symbolic link followed)
+		tempPath[MAX_FILE_PATH];	// where it is written until it is closed
+};
+
+static ASSEMBLY_STATE PATH_HEADER
 	*topPath,
 	*bottomPath;
 
-void CloseTextOutputFile(FILE *file)
-// close the text output file
+static ASSEMBLY_STATE SYM_TABLE
+	*fileLookupSymbols;			// names source files were asked for by, and what was found for them (kept across all passes)
+
+static ASSEMBLY_STATE SOURCE_PROVIDER
+	*sourceProvider;			// if not NULL, this is asked for source text before the file system is searched
+static ASSEMBLY_STATE SOURCE_RELEASE
+	*sourceRelease;				// if not NULL, called when text from sourceProvider is no longer needed
+static ASSEMBLY_STATE void
+	*sourceProviderData;
+
+static ASSEMBLY_STATE const char
+	*workingDirectory;			// if not NULL, relative file names are taken relative to this instead of the process's current directory
+
+static ASSEMBLY_STATE OUTPUT_FILE
+	*openOutputFiles;			// output files which are being written
+
+void SetWorkingDirectory(const char *directory)
+// Make the file names this thread opens relative to directory
+// (or, if directory is NULL, to the process's current directory)
+// NOTE: the process's current directory is shared by all threads, so this is how
+// assemblies running at the same time can each have their own
 {
-	fclose(file);
+	workingDirectory=directory;
 }
 
-FILE *OpenTextOutputFile(const char *name)
-// Open a file for writing text output into
-// If there is a problem, complain and return NULL
+const char *GetWorkingDirectory()
+// Return the directory set by SetWorkingDirectory (NULL if none)
+{
+	return(workingDirectory);
+}
+
+bool CreateFilePath(const char *name,char *path)
+// Make the path which opens the file called name on this thread
+// (name itself, unless it is relative and there is a working directory)
+// If the path would be too long, return false
+{
+	if(workingDirectory&&name[0]!=PATH_SEP)
+	{
+		return(snprintf(path,MAX_FILE_PATH,"%s%c%s",workingDirectory,PATH_SEP,name)<MAX_FILE_PATH);
+	}
+	if(strlen(name)<MAX_FILE_PATH)
+	{
+		strcpy(path,name);
+		return(true);
+	}
+	return(false);
+}
+
+FILE *OpenFile(const char *name,const char *mode)
+// fopen name, taking this thread's working directory into account
+// If the file could not be opened, return NULL, with errno set
+{
+	char
+		path[MAX_FILE_PATH];
+
+	if(CreateFilePath(name,path))
+	{
+		return(fopen(path,mode));
+	}
+	errno=ENAMETOOLONG;
+	return(NULL);
+}
+
+static bool FilesMatch(const char *path1,const char *path2)
+// See if the files at path1 and path2 hold the same bytes
+// If either can not be read, they do not match
 {
 	FILE
-		*file;
+		*file1,
+		*file2;
+	char
+		buffer1[8192],
+		buffer2[8192];
+	size_t
+		length1,
+		length2;
+	bool
+		match;
 
-	if(!(file=fopen(name,"w")))
+	match=false;
+	if((file1=fopen(path1,"rb")))
 	{
-		ReportComplaint(true,"Could not open file '%s'\nOS Reports: %s\n",name,strerror(errno));
+		if((file2=fopen(path2,"rb")))
+		{
+			do
+			{
+				length1=fread(buffer1,1,sizeof(buffer1),file1);
+				length2=fread(buffer2,1,sizeof(buffer2),file2);
+				match=(length1==length2)&&!memcmp(buffer1,buffer2,length1);
+			} while(match&&length1);
+			if(ferror(file1)||ferror(file2))
+			{
+				match=false;
+			}
+			fclose(file2);
+		}
+		fclose(file1);
 	}
-	return(file);
+	return(match);
 }
 
-void CloseBinaryOutputFile(FILE *file)
-// Close the binary output file
+static bool CloseOutputFile(FILE *file)
+// Close an output file opened by OpenOutputFile, and put it in place
+// If it holds exactly what the file it replaces does, the old file (and its time stamp) is kept
+// If there is a problem, complain and return false
+{
+	OUTPUT_FILE
+		**previousFile,
+		*outputFile;
+	bool
+		fail;
+
+	fail=false;
+	previousFile=&openOutputFiles;
+	while((outputFile=*previousFile)&&outputFile->file!=file)
+	{
+		previousFile=&outputFile->nextFile;
+	}
+	if(outputFile)
+	{
+		*previousFile=outputFile->nextFile;
+		fail=(ferror(file)!=0);
+		if(fclose(file))
+		{
+			fail=true;
+		}
+		if(fail)
+		{
+			ReportComplaint(true,"Failed to write file '%s'\nOS Reports: %s\n",outputFile->path,strerror(errno));
+			if(outputFile->replace)
+			{
+				remove(outputFile->tempPath);
+			}
+		}
+		else if(outputFile->replace)
+		{
+			if(FilesMatch(outputFile->tempPath,outputFile->path))
+			{
+				remove(outputFile->tempPath);		// nothing changed, so leave the old one alone
+			}
+			else
+			{
+#ifdef _WIN32
+				remove(outputFile->path);			// rename will not replace a file here (so this is not atomic)
+#endif
+				if(rename(outputFile->tempPath,outputFile->path))
+				{
+					ReportComplaint(true,"Could not replace file '%s'\nOS Reports: %s\n",outputFile->path,strerror(errno));
+					remove(outputFile->tempPath);
+					fail=true;
+				}
+			}
+		}
+		DisposePtr(outputFile);
+	}
+	else
+	{
+		fclose(file);
+	}
+	return(!fail);
+}
+
+static bool ReplaceOutputFile(char *path,unsigned int *mode)
+// See if the output file at path should be written to a temporary file which is then
+// renamed over it. That is only done if there is no file there yet, or it is a regular
+// file (devices, pipes and the like are written to directly, since they can not be replaced).
+// A symbolic link is followed first, so the file it points to is replaced, not the link,
+// and path is changed to that file.
+// If the file exists, its permissions are returned in mode, so the new one can be given them
 {
-	fclose(file);
+	struct stat
+		info;
+#ifndef _WIN32
+	char
+		*resolvedPath;
+#endif
+
+	*mode=0;
+#ifdef _WIN32
+	if(stat(path,&info))
+#else
+	if(!lstat(path,&info)&&S_ISLNK(info.st_mode))
+	{
+		if((resolvedPath=realpath(path,NULL)))	// a dangling link stays a link, and is written through
+		{
+			if(strlen(resolvedPath)<MAX_FILE_PATH)
+			{
+				strcpy(path,resolvedPath);
+			}
+			free(resolvedPath);
+		}
+	}
+	if(lstat(path,&info))
+#endif
+	{
+		return(errno==ENOENT);
+	}
+	if(S_ISREG(info.st_mode))
+	{
+		*mode=info.st_mode&07777;
+		return(true);
+	}
+	return(false);
 }
 
-FILE *OpenBinaryOutputFile(const char *name)
-// Open a file for writing binary output into
+static FILE *OpenOutputFile(const char *name,const char *mode)
+// Open a file for writing output into
+// If name is a regular file (or does not exist yet) the output is written to a temporary file
+// next to it, which is renamed to name when it is closed, so nothing ever sees a partly written output
 // If there is a problem, complain and return NULL
 {
+	OUTPUT_FILE
+		*outputFile;
 	FILE
 		*file;
+	unsigned int
+		fileMode;
 
-	if(!(file=fopen(name,"wb")))
+	file=NULL;
+	if((outputFile=(OUTPUT_FILE *)NewPtr(sizeof(OUTPUT_FILE))))
 	{
+		errno=ENAMETOOLONG;
+		if(CreateFilePath(name,outputFile->path))
+		{
+			if((outputFile->replace=ReplaceOutputFile(outputFile->path,&fileMode)))
+			{
+				if(snprintf(outputFile->tempPath,MAX_FILE_PATH,"%s.%d.%p.tmp",outputFile->path,(int)getpid(),(void *)outputFile)<MAX_FILE_PATH)	// the process and record make the name unique
+				{
+					if((file=fopen(outputFile->tempPath,mode)))
+					{
+#ifndef _WIN32
+						if(fileMode)
+						{
+							fchmod(fileno(file),(mode_t)fileMode);	// keep the permissions of the file being replaced (if that is not allowed, the new file keeps the defaults)
+						}
+#endif
+					}
+				}
+				else
+				{
+					errno=ENAMETOOLONG;
+				}
+			}
+			else
+			{
+				file=fopen(outputFile->path,mode);
+			}
+			if(file)
+			{
+				outputFile->file=file;
+				outputFile->nextFile=openOutputFiles;
+				openOutputFiles=outputFile;
+				return(file);
+			}
+		}
 		ReportComplaint(true,"Could not open file '%s'\nOS Reports: %s\n",name,strerror(errno));
+		DisposePtr(outputFile);
+	}
+	else
+	{
+		ReportComplaint(true,"Failed to allocate output file\n");
 	}
 	return(file);
 }
 
+bool CloseTextOutputFile(FILE *file)
+// close the text output file
+// If there is a problem, complain and return false
+{
+	return(CloseOutputFile(file));
+}
+
+FILE *OpenTextOutputFile(const char *name)
+// Open a file for writing text output into
+// If there is a problem, complain and return NULL
+{
+	return(OpenOutputFile(name,"w"));
+}
+
+bool CloseBinaryOutputFile(FILE *file)
+// Close the binary output file
+// If there is a problem, complain and return false
+{
+	return(CloseOutputFile(file));
+}
+
+FILE *OpenBinaryOutputFile(const char *name)
+// Open a file for writing binary output into
+// If there is a problem, complain and return NULL
+{
+	return(OpenOutputFile(name,"wb"));
+}
+
 
 static SYM_TABLE_NODE *CreateFileNameSymbol(const char *name)
 // Create (or locate) an entry in the global file name symbol table for name
@@ -89,66 +368,602 @@ static SYM_TABLE_NODE *CreateFileNameSymbol(const char *name)
 	return(node);
 }
 
-void CloseSourceFile(FILE *file)
-// Close the source file (leave symbol table entry around because
-// things created when parsing the file are still referencing it)
+#define		READ_CHUNK_SIZE		65536	// buffer size to start with when the size of the file is not known
+
+static bool ReadWholeFile(FILE *file,char **buffer,unsigned int *length)
+// read everything remaining in file into a newly allocated buffer
+// if there is a problem, complain and return false
+// NOTE: the buffer is sized from the file, so a regular file is read in one go. If the size
+// can not be found (pipes), or the file grows, the buffer is doubled until everything fits
+// NOTE: the caller must dispose of buffer if this returns true
 {
-	fclose(file);
+	struct stat
+		fileInfo;
+	char
+		*newBuffer;
+	unsigned int
+		bufferSize;
+	size_t
+		numRead;
+	bool
+		fail;
+
+	fail=false;
+	*length=0;
+	bufferSize=READ_CHUNK_SIZE;
+	if(!fstat(fileno(file),&fileInfo)&&S_ISREG(fileInfo.st_mode)&&fileInfo.st_size>0&&fileInfo.st_size<0x40000000)
+	{
+		bufferSize=(unsigned int)fileInfo.st_size+1;		// one extra, so reaching the end does not look like a full buffer
+	}
+	if((*buffer=(char *)NewPtr(bufferSize)))
+	{
+		while(!fail&&(numRead=fread(&(*buffer)[*length],1,bufferSize-*length,file)))
+		{
+			(*length)+=numRead;
+			if(*length==bufferSize)						// buffer full, so make room for more
+			{
+				if(bufferSize<0x80000000&&(newBuffer=(char *)NewPtr(bufferSize*2)))
+				{
+					memcpy(newBuffer,*buffer,*length);
+					DisposePtr(*buffer);
+					*buffer=newBuffer;
+					bufferSize*=2;
+				}
+				else
+				{
+					ReportComplaint(true,"Could not allocate memory for source file data\nOS Reports: %s\n",strerror(errno));
+					fail=true;
+				}
+			}
+		}
+		if(!fail&&ferror(file))
+		{
+			ReportComplaint(true,"Failed to read source file\nOS Reports: %s\n",strerror(errno));
+			fail=true;
+		}
+		if(!fail)
+		{
+			return(true);
+		}
+		DisposePtr(*buffer);
+	}
+	else
+	{
+		ReportComplaint(true,"Could not allocate memory for source file data\nOS Reports: %s\n",strerror(errno));
+	}
+	return(false);
+}
+
+static const char *FindLineEnd(const char *data,const char *dataEnd)
+// return a pointer to the character which terminates the line starting at data
+// (a new line or a 0), or NULL if the line runs to dataEnd
+{
+	const char
+		*lineEnd,
+		*zero;
+
+	if((lineEnd=(const char *)memchr(data,'\n',dataEnd-data)))
+	{
+		dataEnd=lineEnd;								// any 0 must come before the new line to matter
+	}
+	if((zero=(const char *)memchr(data,'\0',dataEnd-data)))
+	{
+		lineEnd=zero;
+	}
+	return(lineEnd);
+}
+
+static void DestroySourceFileLines(SOURCE_FILE *sourceLines)
+// get rid of the lines read for a source file, and the record which held them
+{
+	SOURCE_LINE
+		*tempLine;
+
+	while(sourceLines->firstLine)
+	{
+		tempLine=sourceLines->firstLine->next;
+		DisposePtr(sourceLines->firstLine);
+		sourceLines->firstLine=tempLine;
+	}
+	DisposePtr(sourceLines);
 }
 
-FILE *OpenSourceFile(const char *name,bool huntForIt,SYM_TABLE_NODE **fileNameSymbol)
-// Open a source/include file
+static bool AddLineToSourceFile(SOURCE_FILE *sourceLines,const char *data,unsigned int dataLength)
+// Add the dataLength characters at data to the end of sourceLines as a line, working out what is known about it as it goes
+// Carriage returns are dropped, and if the line is longer than MAX_STRING-1 characters, it is
+// truncated, and flagged as having overflowed
+{
+	unsigned int
+		length;
+	unsigned int
+		lineIndex;
+	const char
+		*returnChar;
+	SOURCE_LINE
+		*sourceLine;
+
+	length=Min(dataLength,MAX_STRING-1);
+	if((sourceLine=(SOURCE_LINE *)NewPtr(sizeof(SOURCE_LINE)+length+1)))
+	{
+		sourceLine->next=NULL;
+		sourceLine->flags=0;
+		if(!(returnChar=(const char *)memchr(data,'\r',dataLength)))
+		{
+			memcpy(&sourceLine->line[0],data,length);	// the usual case: copy the line straight over
+			if(dataLength>length)
+			{
+				sourceLine->flags|=SLF_OVERFLOW;
+			}
+		}
+		else
+		{
+			length=Min((unsigned int)(returnChar-data),MAX_STRING-1);	// copy over everything but the carriage returns
+			memcpy(&sourceLine->line[0],data,length);
+			if((unsigned int)(returnChar-data)>length)
+			{
+				sourceLine->flags|=SLF_OVERFLOW;
+			}
+			while(++returnChar<data+dataLength)
+			{
+				if(*returnChar!='\r')
+				{
+					if(length<MAX_STRING-1)
+					{
+						sourceLine->line[length++]=*returnChar;
+					}
+					else
+					{
+						sourceLine->flags|=SLF_OVERFLOW;
+					}
+				}
+			}
+		}
+		sourceLine->line[length]='\0';
+		lineIndex=0;
+		if(ParseComment(sourceLine->line,&lineIndex))	// nothing on the line that could ever be assembled?
+		{
+			sourceLine->flags|=SLF_BLANK;
+		}
+		if(sourceLines->lastLine)
+		{
+			sourceLines->lastLine->next=sourceLine;		// link onto the end
+			sourceLines->lastLine=sourceLine;
+		}
+		else
+		{
+			sourceLines->firstLine=sourceLines->lastLine=sourceLine;	// link in as first line
+		}
+		return(true);
+	}
+	return(false);
+}
+
+static SOURCE_FILE *CreateSourceFileLines(const char *data,unsigned int dataLength)
+// Split the dataLength characters at data into a new list of source lines.
+// Lines end at a new line or a 0, and the end of the data always ends one last line
+// (so data which ends with a new line is followed by an empty line).
 // If there is a problem, complain and return NULL
+{
+	SOURCE_FILE
+		*sourceLines;
+	const char
+		*dataEnd,
+		*lineEnd;
+	bool
+		fail;
+
+	fail=false;
+	if((sourceLines=(SOURCE_FILE *)NewPtr(sizeof(SOURCE_FILE))))
+	{
+		sourceLines->firstLine=sourceLines->lastLine=NULL;
+		dataEnd=data+dataLength;
+		do
+		{
+			if(!(lineEnd=FindLineEnd(data,dataEnd)))
+			{
+				lineEnd=dataEnd;						// last line of the data
+			}
+			if(AddLineToSourceFile(sourceLines,data,lineEnd-data))
+			{
+				data=lineEnd+1;
+			}
+			else
+			{
+				ReportComplaint(true,"Could not allocate memory for source line\nOS Reports: %s\n",strerror(errno));
+				fail=true;
+			}
+		} while(!fail&&lineEnd<dataEnd);
+		if(!fail)
+		{
+			return(sourceLines);
+		}
+		DestroySourceFileLines(sourceLines);
+	}
+	else
+	{
+		ReportComplaint(true,"Could not allocate memory for source file\nOS Reports: %s\n",strerror(errno));
+	}
+	return(NULL);
+}
+
+static SOURCE_FILE *GetSourceFileLines(FILE *file,SYM_TABLE_NODE *fileNameSymbol)
+// Return the lines of the source file named by fileNameSymbol.
+// The first time this is called for a given file, its lines are read from file, and
+// kept with fileNameSymbol. After that, the kept lines are returned, and file is not touched.
+// If there is a problem, complain and return NULL
+{
+	SOURCE_FILE
+		*sourceLines;
+	char
+		*fileData;
+	unsigned int
+		fileLength;
+
+	if(!(sourceLines=(SOURCE_FILE *)STNodeData(fileNameSymbol)))
+	{
+		if(ReadWholeFile(file,&fileData,&fileLength))
+		{
+			if((sourceLines=CreateSourceFileLines(fileData,fileLength)))
+			{
+				STSetNodeData(fileNameSymbol,sourceLines);	// remember these for the next time this file is processed
+			}
+			DisposePtr(fileData);
+		}
+	}
+	return(sourceLines);
+}
+
+static SOURCE_FILE *GetProvidedSourceFileLines(const char *text,unsigned int textLength,SYM_TABLE_NODE *fileNameSymbol)
+// Return the lines of the source named by fileNameSymbol, whose text was handed over by the source provider
+// The lines are split out the first time, and kept with fileNameSymbol after that.
+// If there is a problem, complain and return NULL
+{
+	SOURCE_FILE
+		*sourceLines;
+
+	if(!(sourceLines=(SOURCE_FILE *)STNodeData(fileNameSymbol)))
+	{
+		if((sourceLines=CreateSourceFileLines(text,textLength)))
+		{
+			STSetNodeData(fileNameSymbol,sourceLines);
+		}
+	}
+	return(sourceLines);
+}
+
+static bool TrySourceFile(const char *path,FILE **file,const char **text,unsigned int *textLength)
+// See if the source provider holds path, returning its text if so, otherwise try
+// to open path, returning the open file
+// If neither worked, return false, with errno set
+{
+	if(sourceProvider&&sourceProvider(sourceProviderData,path,text,textLength))
+	{
+		*file=NULL;
+		return(true);
+	}
+	return(((*file)=OpenFile(path,"rb"))!=NULL);
+}
+
+static bool FindSourceFile(const char *name,bool huntForIt,char *newPath,FILE **file,const char **text,unsigned int *textLength)
+// Locate a source/include file, returning the path it was found with in newPath
+// If the file was opened, it is returned in file, otherwise file is NULL, and
+// the text handed over by the source provider is returned instead.
 // if huntForIt is true, then look through the include paths trying to locate
 // it.
-// If a file is successfully opened, a pointer to it is returned, along with
-// a pointer to a symbol table entry for its name
+// If the file could not be found, return false, with errno set
 {
-	FILE
-		*file;
-	char
-		newPath[MAX_FILE_PATH];
+	bool
+		found;
 	unsigned int
 		nameLength;
 	PATH_HEADER
 		*path;
 
 	strcpy(newPath,name);
-	if(!(file=fopen(newPath,"rb")))				// try to open the passed file
+	if(!(found=TrySourceFile(newPath,file,text,textLength)))	// try the passed name
 	{
 		if(huntForIt)							// if we failed, see if we need to hunt for it
 		{
 			nameLength=strlen(name);
 			path=topPath;
-			while(path&&!file)
+			while(path&&!found)
 			{
-				if(nameLength+strlen(path->pathName)<sizeof(newPath))		// make sure what we are about to do will not overflow
+				if(nameLength+strlen(path->pathName)<MAX_FILE_PATH)		// make sure what we are about to do will not overflow
 				{
 					sprintf(newPath,"%s%s",path->pathName,name);
-					file=fopen(newPath,"rb");
+					found=TrySourceFile(newPath,file,text,textLength);
 				}
 				path=path->nextPath;
 			}
 		}
 	}
+	return(found);
+}
+
+bool LocateSourceFile(const char *lookupName,char *path)
+// Work out where a source file would be found now, given the name it was looked up by
+// (see NextSourceFileLookup), and return the path it would be found at in path
+// If it could not be found, return false
+{
+	FILE
+		*file;
+	const char
+		*text;
+	unsigned int
+		textLength;
+
+	if(FindSourceFile(&lookupName[1],lookupName[0]=='+',path,&file,&text,&textLength))
+	{
+		if(file)
+		{
+			fclose(file);
+		}
+		else if(sourceRelease)
+		{
+			sourceRelease(sourceProviderData,text);
+		}
+		return(true);
+	}
+	return(false);
+}
+
+static FILE_LOOKUP *CreateFileLookup(const char *lookupName,SYM_TABLE_NODE *fileNameSymbol,int openError)
+// Remember what was found when looking for a source file under lookupName
+// If there is a problem, return NULL
+{
+	FILE_LOOKUP
+		*lookup;
 
-	if(file)
+	if((lookup=(FILE_LOOKUP *)NewPtr(sizeof(FILE_LOOKUP))))
+	{
+		lookup->fileNameSymbol=fileNameSymbol;
+		lookup->openError=openError;
+		if(STAddEntryAtEnd(fileLookupSymbols,lookupName,lookup))
+		{
+			return(lookup);
+		}
+		DisposePtr(lookup);
+	}
+	return(NULL);
+}
+
+void SetSourceProvider(SOURCE_PROVIDER *provider,SOURCE_RELEASE *release,void *providerData)
+// Have this thread ask provider for the text of each source/include file before
+// looking for it in the file system (if provider is NULL, only the file system is used)
+// If release is not NULL, it is called for each text handed over, once it is no longer needed
+{
+	sourceProvider=provider;
+	sourceRelease=release;
+	sourceProviderData=providerData;
+}
+
+void GetSourceProvider(SOURCE_PROVIDER **provider,SOURCE_RELEASE **release,void **providerData)
+// Return what was passed to SetSourceProvider
+{
+	*provider=sourceProvider;
+	*release=sourceRelease;
+	*providerData=sourceProviderData;
+}
+
+bool GetSourceFile(const char *name,bool huntForIt,SYM_TABLE_NODE **fileNameSymbol,SOURCE_FILE **sourceLines)
+// Get the lines of a source/include file
+// if huntForIt is true, then look through the include paths trying to locate
+// it.
+// At each place looked, the source provider (if one is set) is asked for the text,
+// before trying the file system.
+// If the lines are found, they are returned, along with
+// a pointer to a symbol table entry for the file's name
+// If the file could not be opened, complain, and return NULL in sourceLines
+// If there is a hard error, complain and return false
+// NOTE: where name was found (or that it could not be found) is remembered, so
+// on later passes, the file system is not searched again, and files whose lines
+// are already known are not opened again.
+{
+	FILE
+		*file;
+	char
+		lookupName[MAX_FILE_PATH+1],
+		newPath[MAX_FILE_PATH];
+	const char
+		*text;
+	unsigned int
+		textLength;
+	int
+		openError;
+	FILE_LOOKUP
+		*lookup;
+	bool
+		fail;
+
+	fail=false;
+	*sourceLines=NULL;
+	lookupName[0]=huntForIt?'+':'-';				// the same name can be found differently depending on huntForIt, so keep them apart
+	strcpy(&lookupName[1],name);
+	if((lookup=(FILE_LOOKUP *)STFindDataForName(fileLookupSymbols,lookupName)))
+	{
+		if(((*fileNameSymbol)=lookup->fileNameSymbol))
+		{
+			if(((*sourceLines)=(SOURCE_FILE *)STNodeData(lookup->fileNameSymbol)))
+			{
+				return(true);						// seen it before, so use what was read then
+			}
+		}
+		else
+		{
+			AssemblyComplaint(NULL,true,"Could not open source file '%s': %s\n",name,strerror(lookup->openError));
+			return(true);
+		}
+	}
+
+	if(FindSourceFile(name,huntForIt,newPath,&file,&text,&textLength))
 	{
 		if(((*fileNameSymbol)=CreateFileNameSymbol(newPath)))
 		{
-			return(file);
+			if(file)
+			{
+				fail=!((*sourceLines)=GetSourceFileLines(file,*fileNameSymbol));
+			}
+			else
+			{
+				fail=!((*sourceLines)=GetProvidedSourceFileLines(text,textLength,*fileNameSymbol));
+			}
 		}
 		else
 		{
 			AssemblyComplaint(NULL,true,"Failed to create file name symbol table entry\n");
 		}
-		fclose(file);
+		if(file)
+		{
+			fclose(file);
+		}
+		else if(sourceRelease)
+		{
+			sourceRelease(sourceProviderData,text);
+		}
 	}
 	else
 	{
-		AssemblyComplaint(NULL,true,"Could not open source file '%s': %s\n",name,strerror(errno));
+		openError=errno;
+		AssemblyComplaint(NULL,true,"Could not open source file '%s': %s\n",name,strerror(openError));
+		if(!CreateFileLookup(lookupName,NULL,openError))
+		{
+			ReportComplaint(true,"Failed to remember source file location\n");
+			fail=true;
+		}
+	}
+	if(!fail&&(*sourceLines)&&!lookup&&!CreateFileLookup(lookupName,*fileNameSymbol,0))
+	{
+		ReportComplaint(true,"Failed to remember source file location\n");
+		fail=true;
 	}
-	return(NULL);
+	return(!fail);
+}
+
+SYM_TABLE_NODE *NextSourceFileLookup(SYM_TABLE_NODE *lookupNode,const char **lookupName,SYM_TABLE_NODE **fileNameSymbol)
+// Step through the names source files have been looked up by (pass lookupNode as NULL to get the first)
+// Each lookup name is the name asked for, preceded by '+' if the include paths were searched for it,
+// or '-' if not. fileNameSymbol is returned as the file it was found as (NULL if it was not found)
+// Return NULL when there are no more
+{
+	if((lookupNode=lookupNode?STFindNextEntry(fileLookupSymbols,lookupNode):STFindFirstEntry(fileLookupSymbols)))
+	{
+		*lookupName=STNodeName(lookupNode);
+		*fileNameSymbol=((FILE_LOOKUP *)STNodeData(lookupNode))->fileNameSymbol;
+	}
+	return(lookupNode);
+}
+
+SYM_TABLE_NODE *NextFileNameSymbol(SYM_TABLE_NODE *fileNameSymbol,const char **fileName)
+// Step through the names of all files read by the assembly (pass fileNameSymbol as NULL to get the first)
+// Return NULL when there are no more
+{
+	if((fileNameSymbol=fileNameSymbol?STFindNextEntry(fileNameSymbols,fileNameSymbol):STFindFirstEntry(fileNameSymbols)))
+	{
+		*fileName=STNodeName(fileNameSymbol);
+	}
+	return(fileNameSymbol);
+}
+
+static void WriteDependencyName(FILE *file,const char *name)
+// Write name to a dependency file, escaping the characters make treats specially
+{
+	while(*name)
+	{
+		if(*name==' '||*name=='#')
+		{
+			putc('\\',file);
+		}
+		else if(*name=='$')
+		{
+			putc('$',file);
+		}
+		putc(*name,file);
+		name++;
+	}
+}
+
+bool WriteDependencyFile(const char *fileName)
+// Write a make rule to fileName, which says the outputs and listing of this
+// assembly depend on every file it read (sources, includes and incbin data).
+// Each file but the main source also gets a rule with no dependencies, so make
+// does not fail if one of them is removed.
+// If there is a problem, complain and return false
+{
+	FILE
+		*file;
+	SYM_TABLE_NODE
+		*node;
+	const char
+		*outputName;
+	unsigned int
+		i;
+	bool
+		fail;
+
+	fail=false;
+	if((file=OpenTextOutputFile(fileName)))
+	{
+		for(i=0;(outputName=GetOutputFileName(i));i++)
+		{
+			WriteDependencyName(file,outputName);
+			putc(' ',file);
+		}
+		if(listFileName)
+		{
+			WriteDependencyName(file,listFileName);
+			putc(' ',file);
+		}
+		if(!i&&!listFileName)
+		{
+			WriteDependencyName(file,fileName);		// nothing else is made, so make the rule for the dependency file itself
+			putc(' ',file);
+		}
+		putc(':',file);
+		node=STFindFirstEntry(fileNameSymbols);
+		while(node)
+		{
+			fprintf(file," \\\n  ");
+			WriteDependencyName(file,STNodeName(node));
+			node=STFindNextEntry(fileNameSymbols,node);
+		}
+		putc('\n',file);
+		if((node=STFindFirstEntry(fileNameSymbols)))
+		{
+			while((node=STFindNextEntry(fileNameSymbols,node)))	// the main source comes first, and is skipped
+			{
+				putc('\n',file);
+				WriteDependencyName(file,STNodeName(node));
+				fprintf(file,":\n");
+			}
+		}
+		if(ferror(file))
+		{
+			ReportComplaint(true,"Failed to write dependency file '%s'\n",fileName);
+			fail=true;
+		}
+		if(!CloseTextOutputFile(file))
+		{
+			fail=true;
+		}
+	}
+	else
+	{
+		fail=true;
+	}
+	return(!fail);
+}
+
+bool NoteInputFile(const char *name)
+// Remember that the file called name was read by the assembly (as by incbin), so it
+// is listed along with the source files
+// If there is a problem, complain and return false
+{
+	if(CreateFileNameSymbol(name))
+	{
+		return(true);
+	}
+	ReportComplaint(true,"Failed to create file name symbol table entry\n");
+	return(false);
 }
 
 bool AddIncludePath(const char *pathName)
@@ -197,6 +1012,12 @@ void UnInitFiles()
 {
 	PATH_HEADER
 		*nextPath;
+	SYM_TABLE_NODE
+		*node;
+	SOURCE_FILE
+		*sourceLines;
+	FILE_LOOKUP
+		*lookup;
 
 	while(topPath)
 	{
@@ -204,16 +1025,38 @@ void UnInitFiles()
 		DisposePtr(topPath);
 		topPath=nextPath;
 	}
+	node=STFindFirstEntry(fileNameSymbols);
+	while(node)									// get rid of any source lines which were kept
+	{
+		if((sourceLines=(SOURCE_FILE *)STNodeData(node)))
+		{
+			DestroySourceFileLines(sourceLines);
+		}
+		node=STFindNextEntry(fileNameSymbols,node);
+	}
+	node=STFindFirstEntry(fileLookupSymbols);
+	while(node)
+	{
+		lookup=(FILE_LOOKUP *)STNodeData(node);
+		DisposePtr(lookup);
+		node=STFindNextEntry(fileLookupSymbols,node);
+	}
+	STDisposeSymbolTable(fileLookupSymbols);
 	STDisposeSymbolTable(fileNameSymbols);		// get rid of the file names symbol table
 }
 
 bool InitFiles()
 // Initialize file handling
 {
-	if((fileNameSymbols=STNewSymbolTable(100)))
+	if((fileNameSymbols=STNewArenaSymbolTable(100,buildArena)))
 	{
-		topPath=bottomPath=NULL;
-		return(true);
+		if((fileLookupSymbols=STNewSymbolTable(100)))
+		{
+			topPath=bottomPath=NULL;
+			openOutputFiles=NULL;
+			return(true);
+		}
+		STDisposeSymbolTable(fileNameSymbols);
 	}
 	return(false);
 }
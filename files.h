@@ -14,12 +14,22 @@
 //	along with tpasm; see the file "LICENSE.TXT".
 
 
-void CloseTextOutputFile(FILE *file);
+void SetWorkingDirectory(const char *directory);
+const char *GetWorkingDirectory();
+bool CreateFilePath(const char *name,char *path);
+FILE *OpenFile(const char *name,const char *mode);
+bool CloseTextOutputFile(FILE *file);
 FILE *OpenTextOutputFile(const char *name);
-void CloseBinaryOutputFile(FILE *file);
+bool CloseBinaryOutputFile(FILE *file);
 FILE *OpenBinaryOutputFile(const char *name);
-void CloseSourceFile(FILE *file);
-FILE *OpenSourceFile(const char *name,bool huntForIt,SYM_TABLE_NODE **fileNameSymbol);
+void SetSourceProvider(SOURCE_PROVIDER *provider,SOURCE_RELEASE *release,void *providerData);
+void GetSourceProvider(SOURCE_PROVIDER **provider,SOURCE_RELEASE **release,void **providerData);
+bool GetSourceFile(const char *name,bool huntForIt,SYM_TABLE_NODE **fileNameSymbol,SOURCE_FILE **sourceLines);
+bool LocateSourceFile(const char *lookupName,char *path);
+SYM_TABLE_NODE *NextSourceFileLookup(SYM_TABLE_NODE *lookupNode,const char **lookupName,SYM_TABLE_NODE **fileNameSymbol);
+SYM_TABLE_NODE *NextFileNameSymbol(SYM_TABLE_NODE *fileNameSymbol,const char **fileName);
+bool WriteDependencyFile(const char *fileName);
+bool NoteInputFile(const char *name);
 bool AddIncludePath(const char *pathName);
 void UnInitFiles();
 bool InitFiles();
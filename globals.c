@@ -15,92 +15,151 @@
 
 
 // global variables
+// NOTE: all but programName belong to the assembly being run by the current thread
 
 #include	"include.h"
 
-unsigned int
+ASSEMBLY_STATE unsigned int
 	numAllocatedPointers;						// used to track memory leaks
+unsigned int
+	numSharedPointers;							// pointers held by the tables shared by all assemblies (see SetSharedAllocations)
+ASSEMBLY_STATE MEMORY_ARENA
+	*passArena,									// records which last until the end of a pass (reset by ProcessAssembly)
+	*buildArena;								// records which last for the whole assembly (labels, file names)
 const char
 	*programName;								// name of this program (used during error reports)
-const char
+ASSEMBLY_STATE const char
 	*sourceFileName;							// name of the control file
-const char
+ASSEMBLY_STATE const char
 	*listFileName;
-FILE
+ASSEMBLY_STATE FILE
 	*listFile;
-const char
+ASSEMBLY_STATE const char
 	*defaultProcessorName;						// which processor to use by default
-bool
+ASSEMBLY_STATE bool
 	infoOnly;									// set by command line options which report information and abort assembly
-
-unsigned int
+ASSEMBLY_STATE const char
+	*batchFileName;								// manifest of assemblies to run in batch mode (NULL if not in batch mode)
+ASSEMBLY_STATE unsigned int
+	numBatchJobs;								// number of batch assemblies to run at once (0 to run one per processor)
+ASSEMBLY_STATE const char
+	*serveSocketName;							// socket to serve assemblies on (NULL if not serving)
+ASSEMBLY_STATE const char
+	*cacheDirectoryName;						// directory to keep assembly results in (NULL if not caching)
+ASSEMBLY_STATE const char
+	*warmStartFileName;							// file label values are warm started from, and saved to (NULL if none)
+ASSEMBLY_STATE const char
+	*dependencyFileName;						// file to write a make rule naming the assembly's inputs to (NULL if none)
+ASSEMBLY_STATE unsigned char
+	binaryFill;									// byte written to the gaps in binary output
+ASSEMBLY_STATE bool
+	binaryWindow;								// true if binary output is limited to the addresses from binaryWindowStart to binaryWindowEnd
+ASSEMBLY_STATE unsigned int
+	binaryWindowStart,
+	binaryWindowEnd;
+ASSEMBLY_STATE unsigned int
+	hexRecordLength;							// most data bytes put in each hex or S-record
+
+ASSEMBLY_STATE unsigned int
 	includeDepth;								// keep track of number of includes deep
-unsigned int
+ASSEMBLY_STATE unsigned int
 	passCount;									// remembers how many passed have been performed
-unsigned int
+ASSEMBLY_STATE unsigned int
 	maxPasses;									// describes maximum number of passes the assembler will make before giving up
-unsigned int
+ASSEMBLY_STATE unsigned int
 	numUnresolvedLabels,
 	numModifiedLabels;
-bool
+ASSEMBLY_STATE bool
 	intermediatePass;							// true on everything but the last pass
-unsigned int
+ASSEMBLY_STATE unsigned int
 	numBytesGenerated;							// number of bytes generated by assembly of a given line
-char
-	scope[MAX_STRING];							// keeps last non-local program label (so we can create absolute labels out of local ones)
-unsigned int
+ASSEMBLY_STATE unsigned int
 	scopeCount;									// keeps count of number of references within this scope (allows macros to have their own local variable scope)
-unsigned int
+ASSEMBLY_STATE unsigned int
 	scopeValue;									// based on scope-count, keeps the current scope value
 
-unsigned int
+ASSEMBLY_STATE unsigned int
 	blockDepth;									// keep track of number of blocks deep
 
-CONTEXT_RECORD
+ASSEMBLY_STATE CONTEXT_RECORD
 	*contextStack;								// keeps track of the assembly context stack (NULL means use default context)
 
-TEXT_BLOCK
+ASSEMBLY_STATE TEXT_BLOCK
 	*collectingBlock;							// pointer to block of text being collected currently, NULL if none
 
-ALIAS_RECORD
+ASSEMBLY_STATE ALIAS_RECORD
 	*aliasesHead;								// list of operand aliases
 
-MACRO_RECORD
+ASSEMBLY_STATE MACRO_RECORD
 	*macrosHead;								// head of list of macros collected during assembly (the actual macro being built if in macro context)
 
-SYM_TABLE
+ASSEMBLY_STATE SYM_TABLE
 	*fileNameSymbols;							// collected list of all file names encountered during assembly
 
-SYM_TABLE_NODE
+ASSEMBLY_STATE SYM_TABLE_NODE
 	*currentFile,								// pointer to the current file being assembled
 	*currentVirtualFile;						// pointer to the file which contained the line of the text which is currently being assembled (as in a macro expansion)
 
-LABEL_RECORD
-	*labelsHead;								// keeps track of all the labels which have been defined
+ASSEMBLY_STATE LABEL_TABLE
+	labelTable;									// keeps track of all the labels which have been defined
 
-unsigned int
+ASSEMBLY_STATE unsigned int
 	currentFileLine;							// tells which line of the current file is being assembled
-unsigned int
+ASSEMBLY_STATE unsigned int
 	currentVirtualFileLine;						// tells which line of the virtual file contained the text currently being assembled
 
-bool
+ASSEMBLY_STATE bool
 	strictPseudo;								// tells if assembler should limit pseudo-ops to those that start with a dot
 
-unsigned int
+ASSEMBLY_STATE unsigned int
 	errorCount,									// number of errors reported
 	warningCount;								// number of warnings reported
-bool
+ASSEMBLY_STATE bool
 	displayWarnings,							// tells if warnings should be displayed
 	displayDiagnostics;							// tells if diagnostics should be displayed
 
-bool
+ASSEMBLY_STATE bool
 	stopParsing;								// used to tell us to stop assembling (when end statement is encountered)
-bool
+ASSEMBLY_STATE bool
 	outputListing;								// true if listing is to be generated, false otherwise
-bool
+ASSEMBLY_STATE bool
 	outputListingExpansions;					// true if macro and repeat expansions should be present in the listing, false if not
 
-SEGMENT_RECORD
+ASSEMBLY_STATE SEGMENT_RECORD
 	*currentSegment,							// tells which segment is currently being assembled into
 	*segmentsHead,								// pointer to the head of the list of segments
 	*segmentsTail;								// pointer to the tail of the list of segments
+
+void SaveThreadState(THREAD_STATE *state)
+// Copy the parts of this thread's state which threads it starts need into state
+// (file and message settings, and what the output generators look at)
+{
+	state->workingDirectory=GetWorkingDirectory();
+	state->messageFile=GetMessageFile();
+	GetSourceProvider(&state->sourceProvider,&state->sourceRelease,&state->sourceProviderData);
+	state->sourceFileName=sourceFileName;
+	state->segmentsHead=segmentsHead;
+	state->labelTable=labelTable;
+	state->binaryFill=binaryFill;
+	state->binaryWindow=binaryWindow;
+	state->binaryWindowStart=binaryWindowStart;
+	state->binaryWindowEnd=binaryWindowEnd;
+	state->hexRecordLength=hexRecordLength;
+}
+
+void RestoreThreadState(const THREAD_STATE *state)
+// Give this thread the state saved by SaveThreadState (on the thread which started it)
+// NOTE: the segments and labels are shared, not copied, so they must only be read
+{
+	SetWorkingDirectory(state->workingDirectory);
+	SetMessageFile(state->messageFile);
+	SetSourceProvider(state->sourceProvider,state->sourceRelease,state->sourceProviderData);
+	sourceFileName=state->sourceFileName;
+	segmentsHead=state->segmentsHead;
+	labelTable=state->labelTable;
+	binaryFill=state->binaryFill;
+	binaryWindow=state->binaryWindow;
+	binaryWindowStart=state->binaryWindowStart;
+	binaryWindowEnd=state->binaryWindowEnd;
+	hexRecordLength=state->hexRecordLength;
+}
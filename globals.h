@@ -14,89 +14,116 @@
 //	along with tpasm; see the file "LICENSE.TXT".
 
 
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	numAllocatedPointers;
+extern unsigned int
+	numSharedPointers;
+extern ASSEMBLY_STATE MEMORY_ARENA
+	*passArena,
+	*buildArena;
 extern const char
 	*programName;
-extern const char
+extern ASSEMBLY_STATE const char
 	*sourceFileName;
-extern const char
+extern ASSEMBLY_STATE const char
 	*listFileName;
-extern FILE
+extern ASSEMBLY_STATE FILE
 	*listFile;
-extern const char
+extern ASSEMBLY_STATE const char
 	*defaultProcessorName;
-extern bool
+extern ASSEMBLY_STATE bool
 	infoOnly;
-
-extern unsigned int
+extern ASSEMBLY_STATE const char
+	*batchFileName;
+extern ASSEMBLY_STATE unsigned int
+	numBatchJobs;
+extern ASSEMBLY_STATE const char
+	*serveSocketName;
+extern ASSEMBLY_STATE const char
+	*cacheDirectoryName;
+extern ASSEMBLY_STATE const char
+	*warmStartFileName;
+extern ASSEMBLY_STATE const char
+	*dependencyFileName;
+extern ASSEMBLY_STATE unsigned char
+	binaryFill;
+extern ASSEMBLY_STATE bool
+	binaryWindow;
+extern ASSEMBLY_STATE unsigned int
+	binaryWindowStart,
+	binaryWindowEnd;
+extern ASSEMBLY_STATE unsigned int
+	hexRecordLength;
+
+extern ASSEMBLY_STATE unsigned int
 	includeDepth;
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	passCount;
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	maxPasses;
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	numUnresolvedLabels,
 	numModifiedLabels;
-extern bool
+extern ASSEMBLY_STATE bool
 	intermediatePass;
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	numBytesGenerated;
-extern char
-	scope[MAX_STRING];
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	scopeCount;
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	scopeValue;
 
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	blockDepth;
 
-extern CONTEXT_RECORD
+extern ASSEMBLY_STATE CONTEXT_RECORD
 	*contextStack;
 
-extern TEXT_BLOCK
+extern ASSEMBLY_STATE TEXT_BLOCK
 	*collectingBlock;
 
-extern ALIAS_RECORD
+extern ASSEMBLY_STATE ALIAS_RECORD
 	*aliasesHead;
 
-extern MACRO_RECORD
+extern ASSEMBLY_STATE MACRO_RECORD
 	*macrosHead;
 
-extern SYM_TABLE
+extern ASSEMBLY_STATE SYM_TABLE
 	*fileNameSymbols;
 
-extern SYM_TABLE_NODE
+extern ASSEMBLY_STATE SYM_TABLE_NODE
 	*currentFile,
 	*currentVirtualFile;
 
-extern LABEL_RECORD
-	*labelsHead;
+extern ASSEMBLY_STATE LABEL_TABLE
+	labelTable;
 
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	currentFileLine;
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	currentVirtualFileLine;
 
-extern bool
+extern ASSEMBLY_STATE bool
 	strictPseudo;
 
-extern unsigned int
+extern ASSEMBLY_STATE unsigned int
 	errorCount,
 	warningCount;
-extern bool
+extern ASSEMBLY_STATE bool
 	displayWarnings,
 	displayDiagnostics;
 
-extern bool
+extern ASSEMBLY_STATE bool
 	stopParsing;
-extern bool
+extern ASSEMBLY_STATE bool
 	outputListing;
-extern bool
+extern ASSEMBLY_STATE bool
 	outputListingExpansions;
 
-extern SEGMENT_RECORD
+extern ASSEMBLY_STATE SEGMENT_RECORD
 	*currentSegment,
 	*segmentsHead,
 	*segmentsTail;
+
+void SaveThreadState(THREAD_STATE *state);
+void RestoreThreadState(const THREAD_STATE *state);
@@ -37,6 +37,10 @@
 #include	"macro.h"
 #include	"globals.h"
 #include	"processors.h"
+#include	"dispatch.h"
 #include	"support.h"
 #include	"listing.h"
 #include	"outfile.h"
+#include	"batch.h"
+#include	"serve.h"
+#include	"cache.h"
@@ -18,25 +18,129 @@
 
 #include	"include.h"
 
-static SYM_TABLE
+struct LABEL_SEED								// value a label had at the end of a previous assembly
+{
+	LABEL_RECORD
+		label;									// stands in for the label if it is read before it is defined
+	bool
+		read;									// set once the seed has been used by an expression
+};
+
+static ASSEMBLY_STATE SYM_TABLE
 	*labelSymbols;								// symbol table
+static ASSEMBLY_STATE SYM_TABLE
+	*labelSeeds;								// values to warm start labels from (NULL if none were loaded)
+
+static ASSEMBLY_STATE LABEL_RECORD
+	*scopeLabel;								// last non-local program label (so we can create absolute labels out of local ones), NULL if none
+static ASSEMBLY_STATE bool
+	scopeNameKnown;								// set once scopeNameLength has been found for scopeLabel
+static ASSEMBLY_STATE unsigned int
+	scopeNameLength;
+static ASSEMBLY_STATE char
+	scopeValueText[16];							// scopeValueTextValue as text, followed by '@'
+static ASSEMBLY_STATE unsigned int
+	scopeValueTextLength,						// 0 if scopeValueText has not been made yet
+	scopeValueTextValue;
 
 unsigned int NumLabels()
-// Count up the number of labels
+// Return the number of labels
+{
+	return(labelTable.numLabels);
+}
+
+LABEL_RECORD *LabelWithID(unsigned int id)
+// Return the label with the given id (which must be less than labelTable.numIDs)
+// If that label has been destroyed, return NULL
+{
+	LABEL_RECORD
+		*label;
+
+	label=&labelTable.blocks[id/LABEL_BLOCK_SIZE][id%LABEL_BLOCK_SIZE];
+	return(label->symbol?label:NULL);
+}
+
+static int CompareLabels(const void *i,const void *j)
+// compare the labels given by the entries i and j
+// This is called by qsort
+{
+	LABEL_RECORD
+		**recordA,
+		**recordB;
+
+	recordA=(LABEL_RECORD **)i;
+	recordB=(LABEL_RECORD **)j;
+	return(strcmp(STNodeName((*recordA)->symbol),STNodeName((*recordB)->symbol)));
+}
+
+LABEL_RECORD **CreateSortedLabelArray(unsigned int *numLabels)
+// Make an array of pointers to all the labels, sorted by name
+// The array must be disposed of with DisposePtr
+// If there is a problem, return NULL
+{
+	LABEL_RECORD
+		**sortArray,
+		*label;
+	unsigned int
+		id;
+
+	*numLabels=0;
+	if((sortArray=(LABEL_RECORD **)NewPtr(sizeof(LABEL_RECORD *)*Max(labelTable.numLabels,1))))
+	{
+		for(id=0;id<labelTable.numIDs;id++)
+		{
+			if((label=LabelWithID(id)))
+			{
+				sortArray[(*numLabels)++]=label;
+			}
+		}
+		qsort(sortArray,*numLabels,sizeof(LABEL_RECORD *),CompareLabels);
+	}
+	return(sortArray);
+}
+
+static LABEL_RECORD *NewLabelRecord()
+// Give out the record of a destroyed label if there is one, otherwise the record for
+// the next label id, adding a block to the table if needed
+// If there is a problem, return NULL
 {
 	LABEL_RECORD
+		**newBlocks,
 		*label;
 	unsigned int
-		numLabels;
+		newMaxBlocks;
 
-	label=labelsHead;
-	numLabels=0;
-	while(label)
+	if((label=labelTable.freeLabels))
 	{
-		numLabels++;
-		label=label->next;
+		labelTable.freeLabels=label->nextFree;
+		return(label);
+	}
+	if(labelTable.numIDs%LABEL_BLOCK_SIZE==0)			// current block is full (or there is none yet)
+	{
+		if(labelTable.numIDs/LABEL_BLOCK_SIZE>=labelTable.maxBlocks)
+		{
+			newMaxBlocks=labelTable.maxBlocks?labelTable.maxBlocks*2:16;
+			if(!(newBlocks=(LABEL_RECORD **)NewPtr(newMaxBlocks*sizeof(LABEL_RECORD *))))
+			{
+				return(NULL);
+			}
+			if(labelTable.blocks)
+			{
+				memcpy(newBlocks,labelTable.blocks,labelTable.maxBlocks*sizeof(LABEL_RECORD *));
+				DisposePtr(labelTable.blocks);
+			}
+			labelTable.blocks=newBlocks;
+			labelTable.maxBlocks=newMaxBlocks;
+		}
+		if(!(labelTable.blocks[labelTable.numIDs/LABEL_BLOCK_SIZE]=(LABEL_RECORD *)ArenaNewPtr(buildArena,LABEL_BLOCK_SIZE*sizeof(LABEL_RECORD))))
+		{
+			return(NULL);
+		}
 	}
-	return(numLabels);
+	label=&labelTable.blocks[labelTable.numIDs/LABEL_BLOCK_SIZE][labelTable.numIDs%LABEL_BLOCK_SIZE];
+	label->id=labelTable.numIDs++;
+	label->symbol=NULL;
+	return(label);
 }
 
 LABEL_RECORD *LocateLabel(const char *labelName,bool bumpRefCount)
@@ -58,25 +162,103 @@ LABEL_RECORD *LocateLabel(const char *labelName,bool bumpRefCount)
 	return(NULL);
 }
 
-void DestroyLabel(LABEL_RECORD *label)
-// remove label from the global label table
+LABEL_RECORD *ReadLabel(const char *labelName,bool bumpRefCount)
+// Locate a label whose value is about to be used in an expression.
+// This remembers that the label was read during the current pass, so that if
+// its definition later in the pass changes its value, another pass can be requested.
+// On the first pass, a label which has not been defined yet is given the
+// value it was seeded with (if any).
 {
-	STRemoveEntry(labelSymbols,label->symbol);
+	LABEL_RECORD
+		*resultValue;
+
+	LABEL_SEED
+		*seed;
+
+	if((resultValue=LocateLabel(labelName,bumpRefCount)))
+	{
+		resultValue->readPassCount=passCount;
+	}
+	else if(labelSeeds&&!passCount&&(seed=(LABEL_SEED *)STFindDataForName(labelSeeds,labelName)))
+	{
+		seed->read=true;						// on the first pass, labels not yet defined are read from their seeds
+		resultValue=&seed->label;
+	}
+	return(resultValue);
+}
 
-	if(label->next)
+void SetLabelScope(LABEL_RECORD *label)
+// Make label the scope that local labels are created in (NULL for none)
+{
+	if(label!=scopeLabel)
 	{
-		label->next->previous=label->previous;
+		scopeLabel=label;
+		scopeNameKnown=false;
 	}
+}
 
-	if(label->previous)
+unsigned int CopyLocalLabelPrefix(char *label,bool blockLocal)
+// Write the prefix which makes a local label absolute in the current scope into label,
+// and return its length. The prefix is 'scope@', or for labels which are also local to
+// the current text block, 'scope@value@'.
+// NOTE: the prefix is not terminated
+{
+	unsigned int
+		length;
+
+	if(!scopeNameKnown)
 	{
-		label->previous->next=label->next;
+		scopeNameLength=scopeLabel?strlen(STNodeName(scopeLabel->symbol)):0;
+		scopeNameKnown=true;
 	}
-	else
+	if(scopeNameLength)
 	{
-		labelsHead=label->next;
+		memcpy(label,STNodeName(scopeLabel->symbol),scopeNameLength);
+	}
+	length=scopeNameLength;
+	label[length++]='@';
+	if(blockLocal)
+	{
+		if(!scopeValueTextLength||scopeValueTextValue!=scopeValue)
+		{
+			scopeValueTextLength=sprintf(scopeValueText,"%d@",scopeValue);
+			scopeValueTextValue=scopeValue;
+		}
+		memcpy(&label[length],scopeValueText,scopeValueTextLength);
+		length+=scopeValueTextLength;
+	}
+	return(length);
+}
+
+bool IsConstantLabel(LABEL_RECORD *label)
+// Return true if label is a constant of this assembly (defined with equ, or on the command line)
+// NOTE: a value seeded from a warm start file is not counted, since it may be stale
+{
+	return((label->type==LF_CONST||label->type==LF_EXT_CONST)&&LocateLabel(STNodeName(label->symbol),false)==label);
+}
+
+void DestroyLabel(LABEL_RECORD *label)
+// remove label from the global label table
+// NOTE: the record stays in the table, marked as destroyed, until it (and its id)
+// is given out again to a new label
+{
+	STRemoveEntry(labelSymbols,label->symbol);
+	label->symbol=NULL;
+	label->nextFree=labelTable.freeLabels;
+	labelTable.freeLabels=label;
+	labelTable.numLabels--;
+}
+
+static void CountModifiedLabel(LABEL_RECORD *labelRecord)
+// The value of labelRecord is being changed from what it was on the previous pass.
+// Only lines which read the label before this point in the pass could have used the old
+// value (everything after here sees the new one), so another pass is only needed if
+// one of those exists.
+{
+	if(labelRecord->readPassCount==passCount)
+	{
+		numModifiedLabels++;
 	}
-	DisposePtr(label);
 }
 
 static void ReportLabelDefinitionLocation(LABEL_RECORD *labelRecord)
@@ -86,6 +268,24 @@ static void ReportLabelDefinitionLocation(LABEL_RECORD *labelRecord)
 	AssemblySupplement(&labelRecord->whereFrom,"Previous definition was here\n");
 }
 
+static void CheckLabelSeed(const char *labelName,int value,bool resolved)
+// A label is being defined for the first time. If its seed value was used
+// before this, and was wrong, count the label as modified, so another
+// pass will be made.
+{
+	LABEL_SEED
+		*seed;
+
+	if(labelSeeds&&(seed=(LABEL_SEED *)STFindDataForName(labelSeeds,labelName))&&seed->read)
+	{
+		if(!resolved||seed->label.value!=value)
+		{
+			ReportDiagnostic("Modified label: '%s' (seed=%08X, new=%08X)\n",labelName,seed->label.value,value);
+			numModifiedLabels++;
+		}
+	}
+}
+
 LABEL_RECORD *CreateLabel(const char *labelName,int value,unsigned int type,unsigned int passCount,bool resolved)
 // Create a new label in the global table
 // If there is a problem, report it, and return NULL
@@ -95,30 +295,26 @@ LABEL_RECORD *CreateLabel(const char *labelName,int value,unsigned int type,unsi
 
 	if(!LocateLabel(labelName,false))
 	{
-		if((newRecord=(LABEL_RECORD *)NewPtr(sizeof(LABEL_RECORD))))
+		if((newRecord=NewLabelRecord()))
 		{
 			if((newRecord->symbol=STAddEntryAtEnd(labelSymbols,labelName,newRecord)))
 			{
 				newRecord->value=value;
 				newRecord->type=type;
 				newRecord->passCount=passCount;
+				newRecord->readPassCount=passCount;
 				newRecord->resolved=resolved;
 				newRecord->refCount=0;
 				newRecord->whereFrom.file=currentVirtualFile;
 				newRecord->whereFrom.fileLineNumber=currentVirtualFileLine;
-				newRecord->previous=NULL;
-				if((newRecord->next=labelsHead))
-				{
-					labelsHead->previous=newRecord;
-				}
-				labelsHead=newRecord;
+				labelTable.numLabels++;
+				CheckLabelSeed(labelName,value,resolved);
 				return(newRecord);
 			}
 			else
 			{
 				ReportComplaint(true,"Failed to create symbol table entry (Out of memory)\n");
 			}
-			DisposePtr(newRecord);
 		}
 		else
 		{
@@ -139,7 +335,8 @@ bool AssignLabel(const PARSED_LABEL *parsedLabel,int value)
 // If there is a problem assigning the label (hard error), return false
 {
 	LABEL_RECORD
-		*oldLabel;
+		*oldLabel,
+		*newLabel;
 	bool
 		fail;
 
@@ -153,12 +350,12 @@ bool AssignLabel(const PARSED_LABEL *parsedLabel,int value)
 				oldLabel->passCount=passCount;		// update the passcount
 				if(!parsedLabel->isLocal)						// if not local, then update the current scope
 				{
-					strcpy(scope,parsedLabel->name);
+					SetLabelScope(oldLabel);
 				}
 				if(oldLabel->value!=value)	// see if value is changing between passes
 				{
 					ReportDiagnostic("Modified label: '%s' (old=%08X, new=%08X)\n",parsedLabel->name,oldLabel->value,value);
-					numModifiedLabels++;			// it is, so remember that we have modified a label
+					CountModifiedLabel(oldLabel);	// it is, so remember that we have modified a label
 					oldLabel->value=value;	// re-assign new value
 				}
 			}
@@ -176,11 +373,14 @@ bool AssignLabel(const PARSED_LABEL *parsedLabel,int value)
 	}
 	else
 	{
-		if(!parsedLabel->isLocal)					// if not local, then update the current scope
+		if((newLabel=CreateLabel(parsedLabel->name,value,LF_LABEL,passCount,true)))
 		{
-			strcpy(scope,parsedLabel->name);
+			if(!parsedLabel->isLocal)					// if not local, then update the current scope
+			{
+				SetLabelScope(newLabel);
+			}
 		}
-		if(!CreateLabel(parsedLabel->name,value,LF_LABEL,passCount,true))
+		else
 		{
 			fail=true;
 		}
@@ -223,7 +423,7 @@ bool AssignConstant(const char *name,int value,bool resolved)
 							if(oldLabel->value!=value)	// see if value is changing between passes
 							{
 								ReportDiagnostic("Modified label: '%s' (old=%08X, new=%08X)\n",name,oldLabel->value,value);
-								numModifiedLabels++;			// it is, so remember that we have modified a label
+								CountModifiedLabel(oldLabel);	// it is, so remember that we have modified a label
 								oldLabel->value=value;	// re-assign new value
 							}
 						}
@@ -239,7 +439,7 @@ bool AssignConstant(const char *name,int value,bool resolved)
 						if((oldLabel->resolved=resolved))		// resolve it now if we can
 						{
 							oldLabel->value=value;		// assign the current value
-							numModifiedLabels++;				// remember it was messed with
+							CountModifiedLabel(oldLabel);		// remember it was messed with
 						}
 					}
 				}
@@ -365,22 +565,170 @@ bool AssignSetConstant(const char *name,int value,bool resolved)
 	return(!fail);
 }
 
+static void DestroyLabelSeeds()
+// get rid of any label seeds which were loaded
+{
+	SYM_TABLE_NODE
+		*node;
+
+	if(labelSeeds)
+	{
+		node=STFindFirstEntry(labelSeeds);
+		while(node)
+		{
+			DisposePtr(STNodeData(node));
+			node=STFindNextEntry(labelSeeds,node);
+		}
+		STDisposeSymbolTable(labelSeeds);
+		labelSeeds=NULL;
+	}
+}
+
+static bool AddLabelSeed(const char *labelName,int value,unsigned int type)
+// Remember a value to seed labelName with
+// If there is a problem, complain and return false
+{
+	LABEL_SEED
+		*seed;
+
+	if((seed=(LABEL_SEED *)NewPtr(sizeof(LABEL_SEED))))
+	{
+		seed->label.value=value;
+		seed->label.type=type;
+		seed->label.passCount=0;
+		seed->label.readPassCount=0;
+		seed->label.resolved=true;
+		seed->label.refCount=0;
+		seed->label.whereFrom.file=NULL;
+		seed->label.whereFrom.fileLineNumber=0;
+		seed->label.id=0;
+		seed->read=false;
+		if((seed->label.symbol=STAddEntryAtEnd(labelSeeds,labelName,seed)))
+		{
+			return(true);
+		}
+		DisposePtr(seed);
+	}
+	ReportComplaint(true,"Failed to create label seed (Out of memory)\n");
+	return(false);
+}
+
+bool LoadLabelSeeds(const char *fileName)
+// Read the label values saved by SaveLabelSeeds, so that on the first pass, labels
+// which are read before they are defined can start with those values instead of
+// being unresolved. Wrong values are corrected by the passes which follow.
+// If the file does not exist, there is nothing to seed with, and that is fine.
+// If there is a problem, complain and return false
+{
+	FILE
+		*file;
+	char
+		line[MAX_STRING],
+		labelName[MAX_STRING];
+	unsigned int
+		value;
+	char
+		typeChar;
+	bool
+		fail;
+
+	fail=false;
+	DestroyLabelSeeds();
+	if((file=OpenFile(fileName,"r")))
+	{
+		if((labelSeeds=STNewSymbolTable(0)))
+		{
+			while(!fail&&fgets(line,MAX_STRING,file))
+			{
+				if(sscanf(line,"%X %c %s",&value,&typeChar,labelName)==3&&(typeChar=='L'||typeChar=='C')&&!STFindNode(labelSeeds,labelName))
+				{
+					fail=!AddLabelSeed(labelName,(int)value,typeChar=='L'?LF_LABEL:LF_CONST);
+				}
+			}
+			if(fail)
+			{
+				DestroyLabelSeeds();
+			}
+		}
+		else
+		{
+			ReportComplaint(true,"Failed to create label seed symbol table\n");
+			fail=true;
+		}
+		fclose(file);
+	}
+	else if(errno!=ENOENT)
+	{
+		ReportComplaint(true,"Could not open label seed file '%s'\nOS Reports: %s\n",fileName,strerror(errno));
+		fail=true;
+	}
+	return(!fail);
+}
+
+bool SaveLabelSeeds(const char *fileName)
+// Write the values of all labels and constants out to fileName, so that the next
+// assembly can start from them (see LoadLabelSeeds)
+// If there is a problem, complain and return false
+{
+	FILE
+		*file;
+	LABEL_RECORD
+		*label;
+	unsigned int
+		id;
+	bool
+		fail;
+
+	fail=false;
+	if((file=OpenTextOutputFile(fileName)))
+	{
+		for(id=0;id<labelTable.numIDs;id++)
+		{
+			if((label=LabelWithID(id))&&label->resolved&&(label->type==LF_LABEL||label->type==LF_CONST))	// set labels change as they go, so they are no use as seeds
+			{
+				fprintf(file,"%08X %c %s\n",(unsigned int)label->value,label->type==LF_LABEL?'L':'C',STNodeName(label->symbol));
+			}
+		}
+		if(ferror(file))
+		{
+			ReportComplaint(true,"Failed to write label seed file '%s'\n",fileName);
+			fail=true;
+		}
+		if(!CloseTextOutputFile(file))
+		{
+			fail=true;
+		}
+	}
+	else
+	{
+		fail=true;
+	}
+	return(!fail);
+}
+
 void UnInitLabels()
 // undo what InitLabels did
 {
-	while(labelsHead)
+	if(labelTable.blocks)
 	{
-		DestroyLabel(labelsHead);							// get rid of all labels
+		DisposePtr(labelTable.blocks);						// the blocks themselves belong to the build arena
 	}
+	DestroyLabelSeeds();
 	STDisposeSymbolTable(labelSymbols);
 }
 
 bool InitLabels()
 // initialize label table for assembler labels
 {
-	labelsHead=NULL;
+	labelTable.blocks=NULL;
+	labelTable.maxBlocks=labelTable.numIDs=labelTable.numLabels=0;
+	labelTable.freeLabels=NULL;
+	labelSeeds=NULL;
+	scopeLabel=NULL;
+	scopeNameKnown=false;
+	scopeValueTextLength=0;
 
-	if((labelSymbols=STNewSymbolTable(0)))
+	if((labelSymbols=STNewSymbolTable(0)))			// not from the build arena, since the nodes of destroyed labels must be given back
 	{
 		return(true);
 	}
@@ -15,12 +15,20 @@
 
 
 unsigned int NumLabels();
+LABEL_RECORD *LabelWithID(unsigned int id);
+LABEL_RECORD **CreateSortedLabelArray(unsigned int *numLabels);
 LABEL_RECORD *LocateLabel(const char *labelName,bool bumpRefCount);
+LABEL_RECORD *ReadLabel(const char *labelName,bool bumpRefCount);
+void SetLabelScope(LABEL_RECORD *label);
+unsigned int CopyLocalLabelPrefix(char *label,bool blockLocal);
+bool IsConstantLabel(LABEL_RECORD *label);
 void DestroyLabel(LABEL_RECORD *label);
 LABEL_RECORD *CreateLabel(const char *labelName,int value,unsigned int type,unsigned int passCount,bool resolved);
 bool AssignLabel(const PARSED_LABEL *parsedLabel,int value);
 bool AssignConstant(const char *name,int value,bool resolved);
 void UnAssignSetConstant(const char *name);
 bool AssignSetConstant(const char *name,int value,bool resolved);
+bool LoadLabelSeeds(const char *fileName);
+bool SaveLabelSeeds(const char *fileName);
 void UnInitLabels();
 bool InitLabels();
@@ -0,0 +1,436 @@
+//	Copyright (C) 1999-2012 Core Technologies.
+//
+//	This file is part of tpasm.
+//
+//	tpasm is free software; you can redistribute it and/or modify
+//	it under the terms of the tpasm LICENSE AGREEMENT.
+//
+//	tpasm is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	tpasm LICENSE AGREEMENT for more details.
+//
+//	You should have received a copy of the tpasm LICENSE AGREEMENT
+//	along with tpasm; see the file "LICENSE.TXT".
+
+
+// In-memory assembly interface (see libtpasm.h)
+// An assembly is run just as it would be from the command line, but with this thread's
+// source provider, message capture and output collector pointed here, so the sources come
+// from the caller's buffers, and what the assembly reports and makes is gathered into a result.
+// NOTE: everything in the result is allocated with malloc (not NewPtr) since it is handed
+// over to the caller, and outlives the assembly.
+
+#include	"include.h"
+#include	"libtpasm.h"
+
+struct LIBRARY_ASSEMBLY					// an assembly being run for the library, and the result being built for it
+{
+	const TPASM_OPTIONS
+		*options;
+	TPASM_RESULT
+		*result;
+	unsigned int
+		maxDiagnostics,					// number of entries result->diagnostics has room for
+		maxBlocks,						// number of entries result->blocks has room for
+		maxBlockData;					// number of bytes the last block has room for
+	SEGMENT_RECORD
+		*blockSegment;					// segment the last block came from
+	bool
+		outOfMemory;					// set if some part of the result could not be allocated
+};
+
+static const unsigned int
+	diagnosticTypes[]=					// library message type for each MT_ message type
+	{
+		TPASM_ERROR,
+		TPASM_WARNING,
+		TPASM_SUPPLEMENT,
+		TPASM_INDIRECT,
+	};
+
+static bool GrowArray(void **array,unsigned int *maxElements,unsigned int numElements,size_t elementSize)
+// Make sure array has room for at least numElements elements, growing it if needed
+// If there is a problem, return false, leaving array as it was
+{
+	unsigned int
+		newMaxElements;
+	void
+		*newArray;
+
+	if(numElements>*maxElements)
+	{
+		newMaxElements=Max(numElements,Max(*maxElements*2,16));
+		if((newArray=realloc(*array,newMaxElements*elementSize)))
+		{
+			*array=newArray;
+			*maxElements=newMaxElements;
+		}
+		else
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+static char *CopyString(const char *string,unsigned int length)
+// Make a malloc'ed, 0 terminated copy of the first length characters of string
+// If there is a problem, return NULL
+{
+	char
+		*copy;
+
+	if((copy=(char *)malloc(length+1)))
+	{
+		memcpy(copy,string,length);
+		copy[length]='\0';
+	}
+	return(copy);
+}
+
+static bool ProvideSource(void *providerData,const char *name,const char **text,unsigned int *textLength)
+// Hand the assembler the text of the caller's source which is called name (if there is one)
+{
+	LIBRARY_ASSEMBLY
+		*assembly;
+	unsigned int
+		i;
+
+	assembly=(LIBRARY_ASSEMBLY *)providerData;
+	for(i=0;i<assembly->options->numSources;i++)
+	{
+		if(!strcmp(assembly->options->sources[i].name,name))
+		{
+			*text=assembly->options->sources[i].text;
+			*textLength=assembly->options->sources[i].textLength;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+static void CaptureMessage(void *captureData,unsigned int messageType,const char *fileName,unsigned int lineNumber,const char *message)
+// Add a message reported by the assembler to the result's diagnostics
+{
+	LIBRARY_ASSEMBLY
+		*assembly;
+	TPASM_RESULT
+		*result;
+	TPASM_DIAGNOSTIC
+		*diagnostic;
+	unsigned int
+		length;
+	bool
+		fail;
+
+	assembly=(LIBRARY_ASSEMBLY *)captureData;
+	result=assembly->result;
+	fail=true;
+	if(GrowArray((void **)&result->diagnostics,&assembly->maxDiagnostics,result->numDiagnostics+1,sizeof(TPASM_DIAGNOSTIC)))
+	{
+		diagnostic=&result->diagnostics[result->numDiagnostics];
+		diagnostic->type=diagnosticTypes[messageType];
+		diagnostic->fileName=NULL;
+		diagnostic->lineNumber=lineNumber;
+		length=strlen(message);
+		if(length&&message[length-1]=='\n')			// messages are reported with a new line at the end, which is not wanted here
+		{
+			length--;
+		}
+		if((diagnostic->message=CopyString(message,length)))
+		{
+			if(!fileName||(diagnostic->fileName=CopyString(fileName,strlen(fileName))))
+			{
+				result->numDiagnostics++;
+				fail=false;
+			}
+			else
+			{
+				free(diagnostic->message);
+			}
+		}
+	}
+	if(fail)
+	{
+		assembly->outOfMemory=true;
+	}
+}
+
+static bool AddBlockByte(LIBRARY_ASSEMBLY *assembly,SEGMENT_RECORD *segment,unsigned int address,unsigned char value)
+// Add value to the result's image at address in segment, extending the last block if it
+// ends just before address, or starting a new block if not
+// If there is a problem, return false
+{
+	TPASM_RESULT
+		*result;
+	TPASM_BLOCK
+		*block;
+
+	result=assembly->result;
+	block=result->numBlocks?&result->blocks[result->numBlocks-1]:NULL;
+	if(!block||segment!=assembly->blockSegment||address!=block->address+block->length)
+	{
+		if(!GrowArray((void **)&result->blocks,&assembly->maxBlocks,result->numBlocks+1,sizeof(TPASM_BLOCK)))
+		{
+			return(false);
+		}
+		block=&result->blocks[result->numBlocks];
+		if(!(block->segmentName=CopyString(STNodeName(segment->symbol),strlen(STNodeName(segment->symbol)))))
+		{
+			return(false);
+		}
+		block->address=address;
+		block->length=0;
+		block->data=NULL;
+		assembly->maxBlockData=0;
+		assembly->blockSegment=segment;
+		result->numBlocks++;
+	}
+	if(!GrowArray((void **)&block->data,&assembly->maxBlockData,block->length+1,1))
+	{
+		return(false);
+	}
+	block->data[block->length++]=value;
+	return(true);
+}
+
+static bool CollectSegment(LIBRARY_ASSEMBLY *assembly,SEGMENT_RECORD *segment)
+// Add the bytes of segment which are in use to the result's image
+// if segment is marked as not generating output, nothing is added
+// If there is a problem, return false
+{
+	CODE_PAGE
+		*page;
+	unsigned int
+		i;
+
+	if(segment->generateOutput)
+	{
+		page=segment->firstPage;
+		while(page)
+		{
+			for(i=0;i<256;i++)
+			{
+				if(page->usageMap[i>>3]&(1<<(i&7)))
+				{
+					if(!AddBlockByte(assembly,segment,page->address+i,page->pageData[i]))
+					{
+						return(false);
+					}
+				}
+			}
+			page=page->next;
+		}
+	}
+	return(true);
+}
+
+static bool CollectLabels(LIBRARY_ASSEMBLY *assembly)
+// Copy all the labels into the result
+// If there is a problem, return false
+{
+	TPASM_RESULT
+		*result;
+	LABEL_RECORD
+		*label;
+	TPASM_LABEL
+		*resultLabel;
+	unsigned int
+		id;
+
+	result=assembly->result;
+	if((result->labels=(TPASM_LABEL *)malloc(Max(NumLabels(),1)*sizeof(TPASM_LABEL))))
+	{
+		for(id=0;id<labelTable.numIDs;id++)
+		{
+			if((label=LabelWithID(id)))				// destroyed labels leave holes
+			{
+				resultLabel=&result->labels[result->numLabels];
+				if(!(resultLabel->name=CopyString(STNodeName(label->symbol),strlen(STNodeName(label->symbol)))))
+				{
+					return(false);
+				}
+				resultLabel->value=label->value;
+				resultLabel->resolved=label->resolved;
+				result->numLabels++;
+			}
+		}
+		return(true);
+	}
+	return(false);
+}
+
+static bool CollectOutput(void *collectorData)
+// Copy the image and labels made by the final pass into the result
+// NOTE: running out of memory here is not treated as a hard failure of the assembly,
+// it is noted in the result instead
+{
+	LIBRARY_ASSEMBLY
+		*assembly;
+	SEGMENT_RECORD
+		*segment;
+
+	assembly=(LIBRARY_ASSEMBLY *)collectorData;
+	segment=segmentsHead;
+	while(segment&&!assembly->outOfMemory)
+	{
+		if(!CollectSegment(assembly,segment))
+		{
+			assembly->outOfMemory=true;
+		}
+		segment=segment->next;
+	}
+	if(!assembly->outOfMemory&&!CollectLabels(assembly))
+	{
+		assembly->outOfMemory=true;
+	}
+	return(true);
+}
+
+static char **CreateArguments(const TPASM_OPTIONS *options,unsigned int *argc)
+// Make the command line which runs the assembly described by options
+// If there is a problem, return NULL
+// NOTE: the result is a single pointer, so DisposePtr gets rid of all of it
+{
+	char
+		**argv;
+	char
+		*valueText;
+	unsigned int
+		i;
+
+	if((argv=(char **)NewPtr((10+options->numDefines*3)*sizeof(char *)+(options->numDefines+1)*16)))
+	{
+		valueText=(char *)&argv[10+options->numDefines*3];	// room for the text of each number given
+		*argc=0;
+		argv[(*argc)++]=(char *)programName;
+		if(options->processorName)
+		{
+			argv[(*argc)++]=(char *)"-P";
+			argv[(*argc)++]=(char *)options->processorName;
+		}
+		if(options->maxPasses)
+		{
+			sprintf(valueText,"%u",options->maxPasses);
+			argv[(*argc)++]=(char *)"-n";
+			argv[(*argc)++]=valueText;
+			valueText+=16;
+		}
+		if(options->strictPseudo)
+		{
+			argv[(*argc)++]=(char *)"-s";
+		}
+		if(options->suppressWarnings)
+		{
+			argv[(*argc)++]=(char *)"-w";
+		}
+		for(i=0;i<options->numDefines;i++)
+		{
+			sprintf(valueText,"%d",options->defines[i].value);
+			argv[(*argc)++]=(char *)"-d";
+			argv[(*argc)++]=(char *)options->defines[i].name;
+			argv[(*argc)++]=valueText;
+			valueText+=16;
+		}
+		argv[(*argc)++]=(char *)options->sources[0].name;
+		argv[*argc]=NULL;
+	}
+	return(argv);
+}
+
+void TPAsmDisposeResult(TPASM_RESULT *result)
+// Get rid of a result returned by TPAsmAssemble
+{
+	unsigned int
+		i;
+
+	for(i=0;i<result->numBlocks;i++)
+	{
+		free(result->blocks[i].segmentName);
+		free(result->blocks[i].data);
+	}
+	free(result->blocks);
+	for(i=0;i<result->numLabels;i++)
+	{
+		free(result->labels[i].name);
+	}
+	free(result->labels);
+	for(i=0;i<result->numDiagnostics;i++)
+	{
+		free(result->diagnostics[i].fileName);
+		free(result->diagnostics[i].message);
+	}
+	free(result->diagnostics);
+	free(result);
+}
+
+TPASM_RESULT *TPAsmAssemble(const TPASM_OPTIONS *options)
+// Assemble options->sources[0], and return what came of it
+// The result must be disposed of with TPAsmDisposeResult
+// If options has no sources, or there is not enough memory for the result, return NULL
+{
+	LIBRARY_ASSEMBLY
+		assembly;
+	char
+		**argv;
+	unsigned int
+		argc;
+	bool
+		succeeded;
+
+	if(options->numSources)
+	{
+		if((assembly.result=(TPASM_RESULT *)calloc(1,sizeof(TPASM_RESULT))))
+		{
+			assembly.options=options;
+			assembly.maxDiagnostics=0;
+			assembly.maxBlocks=0;
+			assembly.maxBlockData=0;
+			assembly.blockSegment=NULL;
+			assembly.outOfMemory=false;
+			if((argv=CreateArguments(options,&argc)))
+			{
+				SetSourceProvider(ProvideSource,NULL,&assembly);
+				SetMessageCapture(CaptureMessage,&assembly);
+				SetOutputCollector(CollectOutput,&assembly);
+
+				succeeded=RunAssembly(argc,argv);
+
+				SetOutputCollector(NULL,NULL);
+				SetMessageCapture(NULL,NULL);
+				SetSourceProvider(NULL,NULL,NULL);
+				DisposePtr(argv);
+
+				assembly.result->succeeded=succeeded;
+				assembly.result->numErrors=errorCount;
+				assembly.result->numWarnings=warningCount;
+				if(!assembly.outOfMemory)
+				{
+					return(assembly.result);
+				}
+			}
+			TPAsmDisposeResult(assembly.result);
+		}
+	}
+	return(NULL);
+}
+
+void TPAsmUnInit(void)
+// undo what TPAsmInit did
+{
+	UnInitAssemblerTables();
+}
+
+int TPAsmInit(void)
+// Set up the tables shared by all assemblies
+// This must be called once, before any other library call
+// If there is a problem, return 0
+{
+	programName="libtpasm";
+	if(InitAssemblerTables())
+	{
+		return(1);
+	}
+	return(0);
+}
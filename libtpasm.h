@@ -0,0 +1,145 @@
+//	Copyright (C) 1999-2012 Core Technologies.
+//
+//	This file is part of tpasm.
+//
+//	tpasm is free software; you can redistribute it and/or modify
+//	it under the terms of the tpasm LICENSE AGREEMENT.
+//
+//	tpasm is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	tpasm LICENSE AGREEMENT for more details.
+//
+//	You should have received a copy of the tpasm LICENSE AGREEMENT
+//	along with tpasm; see the file "LICENSE.TXT".
+
+
+// C interface to the assembler, for programs which link with libtpasm.a
+// Source is passed in from memory, and the image, labels and messages come
+// back as data. No files are read or written unless the source includes
+// something which was not passed in.
+//
+// Call TPAsmInit once before any assembly. After that, TPAsmAssemble may be
+// called from any number of threads at the same time.
+// Link with: libtpasm.a -lstdc++ -lpthread
+
+#ifndef LIBTPASM_H
+#define LIBTPASM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TPASM_SOURCE
+{
+	const char
+		*name;							// name the source is known by (for include, and in messages)
+	const char
+		*text;							// text of the source (need not be 0 terminated)
+	unsigned int
+		textLength;						// number of characters at text
+} TPASM_SOURCE;
+
+typedef struct TPASM_DEFINE				// label defined before assembly starts (like -d on the command line)
+{
+	const char
+		*name;
+	int
+		value;
+} TPASM_DEFINE;
+
+typedef struct TPASM_OPTIONS
+{
+	const char
+		*processorName;					// processor to start with (NULL or "" for none)
+	const TPASM_SOURCE
+		*sources;						// sources[0] is assembled, the rest are there to be included by name
+	unsigned int
+		numSources;
+	const TPASM_DEFINE
+		*defines;
+	unsigned int
+		numDefines;
+	unsigned int
+		maxPasses;						// most passes to make before giving up (0 for the default)
+	int
+		strictPseudo;					// non-zero to only accept pseudo-ops which start with '.'
+	int
+		suppressWarnings;				// non-zero to leave out warnings
+} TPASM_OPTIONS;
+
+// message types (see TPASM_DIAGNOSTIC)
+
+enum
+{
+	TPASM_ERROR,
+	TPASM_WARNING,
+	TPASM_SUPPLEMENT,					// more information about the previous error or warning
+	TPASM_INDIRECT,						// where the previous message was generated from, when it came out of a macro, repeat, etc...
+};
+
+typedef struct TPASM_DIAGNOSTIC
+{
+	unsigned int
+		type;							// one of the message types above
+	char
+		*fileName;						// source the message is about (NULL if none)
+	unsigned int
+		lineNumber;
+	char
+		*message;						// text of the message (without a trailing new line)
+} TPASM_DIAGNOSTIC;
+
+typedef struct TPASM_BLOCK				// run of bytes generated at consecutive addresses in one segment
+{
+	char
+		*segmentName;
+	unsigned int
+		address;
+	unsigned int
+		length;
+	unsigned char
+		*data;
+} TPASM_BLOCK;
+
+typedef struct TPASM_LABEL
+{
+	char
+		*name;
+	int
+		value;
+	int
+		resolved;						// non-zero if value is known
+} TPASM_LABEL;
+
+typedef struct TPASM_RESULT
+{
+	int
+		succeeded;						// non-zero if the assembly completed with no errors
+	unsigned int
+		numErrors,
+		numWarnings;
+	TPASM_BLOCK
+		*blocks;						// image made by the assembly (only if it succeeded)
+	unsigned int
+		numBlocks;
+	TPASM_LABEL
+		*labels;						// labels at the end of the assembly (only if it succeeded)
+	unsigned int
+		numLabels;
+	TPASM_DIAGNOSTIC
+		*diagnostics;					// every message reported, in order
+	unsigned int
+		numDiagnostics;
+} TPASM_RESULT;
+
+void TPAsmDisposeResult(TPASM_RESULT *result);
+TPASM_RESULT *TPAsmAssemble(const TPASM_OPTIONS *options);
+void TPAsmUnInit(void);
+int TPAsmInit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
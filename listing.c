@@ -16,12 +16,78 @@
 
 #include	"include.h"
 
+static ASSEMBLY_STATE MESSAGE_CAPTURE
+	*messageCapture;					// if not NULL, messages are handed to this instead of being written to stderr
+static ASSEMBLY_STATE void
+	*messageCaptureData;
+static ASSEMBLY_STATE FILE
+	*messageFile;						// if not NULL, messages are written here instead of to stderr
+
+static void LockMessageFile(FILE *file)
+// Keep other threads from writing to file until UnlockMessageFile is called
+{
+#if defined(NO_THREADS)
+	(void)file;
+#elif defined(_WIN32)
+	_lock_file(file);
+#else
+	flockfile(file);
+#endif
+}
+
+static void UnlockMessageFile(FILE *file)
+// Let other threads write to file again
+{
+#if defined(NO_THREADS)
+	(void)file;
+#elif defined(_WIN32)
+	_unlock_file(file);
+#else
+	funlockfile(file);
+#endif
+}
+
+static char *TimeString(time_t *timeVal,char *string)
+// Write timeVal as text (in the form ctime gives) into string, which must hold at least 26 bytes
+// and return it
+{
+#if defined(NO_THREADS)
+	strcpy(string,ctime(timeVal));
+#elif defined(_WIN32)
+	ctime_s(string,26,timeVal);
+#else
+	ctime_r(timeVal,string);
+#endif
+	return(string);
+}
+
+void SetMessageCapture(MESSAGE_CAPTURE *capture,void *captureData)
+// Hand all messages reported by this thread to capture (or, if capture is NULL,
+// go back to writing them to stderr)
+{
+	messageCapture=capture;
+	messageCaptureData=captureData;
+}
+
+void SetMessageFile(FILE *file)
+// Write the messages reported by this thread to file
+// (or, if file is NULL, go back to writing them to stderr)
+{
+	messageFile=file;
+}
+
+FILE *GetMessageFile()
+// Return the file this thread's messages are written to
+{
+	return(messageFile?messageFile:stderr);
+}
+
 static void vReportDiagnostic(const char *format,va_list args)
 // Display diagnostic messages
 {
 	if(displayDiagnostics)
 	{
-		vfprintf(stderr,format,args);
+		vfprintf(GetMessageFile(),format,args);
 	}
 }
 
@@ -36,39 +102,61 @@ void ReportDiagnostic(const char *format,...)
 	va_end(args);
 }
 
-static void vReportMessage(const char *fileName,unsigned int lineNumber,const char *type,const char *format,va_list args)
+static void vReportMessage(const char *fileName,unsigned int lineNumber,unsigned int messageType,const char *format,va_list args)
 // report messages (errors, warnings, etc...)
-// type is a string which is descriptive of the message type
-// This will report to the stderr.
+// This will report to the stderr (or the thread's message file), unless a message capture function is installed,
+// in which case the message is handed to it instead.
 // NOTE: this will report during any pass of assembly
 {
+	static const char
+		*messageTypeNames[]=				// descriptive strings for each message type
+		{
+			"error  ",
+			"warning",
+			"       ",
+			"^      ",
+		};
+	char
+		message[MAX_STRING];
 	unsigned int
 		length;
+	FILE
+		*file;
 
-	if(fileName)
+	if(messageCapture)
+	{
+		vsnprintf(message,MAX_STRING,format,args);
+		messageCapture(messageCaptureData,messageType,fileName,lineNumber,message);
+	}
+	else
 	{
-		length=strlen(fileName);
-		if(length<16)			// work out how much to space over to the error message
+		file=GetMessageFile();
+		LockMessageFile(file);	// keep the message together if other threads are reporting too
+		if(fileName)
 		{
-			length=16-length;
+			length=strlen(fileName);
+			if(length<16)		// work out how much to space over to the error message
+			{
+				length=16-length;
+			}
+			else
+			{
+				length=0;
+			}
+			fprintf(file,"%s:%-6d%*s:",fileName,lineNumber,length,"");
 		}
 		else
 		{
-			length=0;
+			fprintf(file,"<command line>         :");
 		}
-		fprintf(stderr,"%s:%-6d%*s:",fileName,lineNumber,length,"");
+		fprintf(file,"%s: ",messageTypeNames[messageType]);
+		vfprintf(file,format,args);
+		UnlockMessageFile(file);
 	}
-	else
-	{
-		fprintf(stderr,"<command line>         :");
-	}
-	fprintf(stderr,"%s: ",type);
-	vfprintf(stderr,format,args);
 }
 
-static void ReportMessage(const char *fileName,unsigned int lineNumber,const char *type,const char *format,...)
+static void ReportMessage(const char *fileName,unsigned int lineNumber,unsigned int messageType,const char *format,...)
 // report messages (errors, warnings, etc...)
-// type is a string which is descriptive of the message type
 // This will report to the stderr.
 // NOTE: this will report during any pass of assembly
 {
@@ -76,7 +164,7 @@ static void ReportMessage(const char *fileName,unsigned int lineNumber,const cha
 		args;
 
 	va_start(args,format);
-	vReportMessage(fileName,lineNumber,type,format,args);
+	vReportMessage(fileName,lineNumber,messageType,format,args);
 	va_end(args);
 }
 
@@ -86,7 +174,7 @@ static void ReportVirtualPosition()
 {
 	if(currentVirtualFile&&(currentFile!=currentVirtualFile||currentFileLine!=currentVirtualFileLine))
 	{
-		ReportMessage(STNodeName(currentVirtualFile),currentVirtualFileLine,"^      ","Previous message generated indirectly from here\n");
+		ReportMessage(STNodeName(currentVirtualFile),currentVirtualFileLine,MT_INDIRECT,"Previous message generated indirectly from here\n");
 	}
 }
 
@@ -107,11 +195,11 @@ static void vReportComplaint(WHERE_FROM *whereFrom,bool isError,const char *form
 
 		if(whereFrom)
 		{
-			vReportMessage(whereFrom->file?STNodeName(whereFrom->file):NULL,whereFrom->fileLineNumber,isError?"error  ":"warning",format,args);
+			vReportMessage(whereFrom->file?STNodeName(whereFrom->file):NULL,whereFrom->fileLineNumber,isError?MT_ERROR:MT_WARNING,format,args);
 		}
 		else
 		{
-			vReportMessage(currentFile?STNodeName(currentFile):NULL,currentFileLine,isError?"error  ":"warning",format,args);
+			vReportMessage(currentFile?STNodeName(currentFile):NULL,currentFileLine,isError?MT_ERROR:MT_WARNING,format,args);
 			ReportVirtualPosition();
 		}
 		if(listFile&&outputListing)
@@ -145,11 +233,11 @@ static void vReportSupplement(WHERE_FROM *whereFrom,const char *format,va_list a
 {
 	if(whereFrom)
 	{
-		vReportMessage(whereFrom->file?STNodeName(whereFrom->file):NULL,whereFrom->fileLineNumber,"       ",format,args);
+		vReportMessage(whereFrom->file?STNodeName(whereFrom->file):NULL,whereFrom->fileLineNumber,MT_SUPPLEMENT,format,args);
 	}
 	else
 	{
-		vReportMessage(currentFile?STNodeName(currentFile):NULL,currentFileLine,"       ",format,args);
+		vReportMessage(currentFile?STNodeName(currentFile):NULL,currentFileLine,MT_SUPPLEMENT,format,args);
 		ReportVirtualPosition();
 	}
 }
@@ -200,9 +288,95 @@ void AssemblySupplement(WHERE_FROM *whereFrom,const char *format,...)
 	}
 }
 
+static void FormatListObjectBytes(LISTING_RECORD *listingRecord)
+// Format any object code being held by listingRecord onto the end of its
+// listObjectString, and empty the holding buffer
+{
+	unsigned int
+		length;
+	unsigned int
+		i;
+
+	length=strlen(listingRecord->listObjectString);
+	if(listingRecord->listObjectWords)
+	{
+		for(i=0;i+1<listingRecord->numListObjectBytes&&length+6<MAX_STRING;i+=2)
+		{
+			sprintf(&listingRecord->listObjectString[length],"%04X ",(listingRecord->listObjectBytes[i]<<8)|listingRecord->listObjectBytes[i+1]);
+			length+=5;
+		}
+	}
+	else
+	{
+		for(i=0;i<listingRecord->numListObjectBytes&&length+4<MAX_STRING;i++)
+		{
+			sprintf(&listingRecord->listObjectString[length],"%02X ",listingRecord->listObjectBytes[i]);
+			length+=3;
+		}
+	}
+	listingRecord->numListObjectBytes=0;
+}
+
+static void AddListObjectData(LISTING_RECORD *listingRecord,const unsigned char *bytes,unsigned int numBytes,bool words)
+// Hold bytes of object code for listingRecord until the line is listed
+// NOTE: if the kind of data being held changes, what is held so far is formatted first
+// NOTE: data which does not fit is dropped, it could not have fit into listObjectString anyway
+{
+	if(listFile)											// no point remembering any of this if there is no listing
+	{
+		if(listingRecord->listObjectWords!=words)
+		{
+			if(listingRecord->numListObjectBytes)
+			{
+				FormatListObjectBytes(listingRecord);
+			}
+			listingRecord->listObjectWords=words;
+		}
+		numBytes=Min(numBytes,sizeof(listingRecord->listObjectBytes)-listingRecord->numListObjectBytes);
+		memcpy(&listingRecord->listObjectBytes[listingRecord->numListObjectBytes],bytes,numBytes);
+		listingRecord->numListObjectBytes+=numBytes;
+	}
+}
+
+void AddListObjectBytes(LISTING_RECORD *listingRecord,const unsigned char *bytes,unsigned int numBytes)
+// Add bytes of generated object code to the listing of the line
+{
+	AddListObjectData(listingRecord,bytes,numBytes,false);
+}
+
+void AddListObjectWord(LISTING_RECORD *listingRecord,unsigned int word)
+// Add a 16 bit word of generated object code to the listing of the line
+// NOTE: a value too big to be held as a word is formatted right away, so it lists exactly as given
+{
+	unsigned char
+		bytes[2];
+	unsigned int
+		length;
+
+	if(word<=0xFFFF)
+	{
+		bytes[0]=word>>8;
+		bytes[1]=word&0xFF;
+		AddListObjectData(listingRecord,bytes,2,true);
+	}
+	else if(listFile)
+	{
+		if(listingRecord->numListObjectBytes)
+		{
+			FormatListObjectBytes(listingRecord);
+		}
+		length=strlen(listingRecord->listObjectString);
+		if(length+6<MAX_STRING)
+		{
+			sprintf(&listingRecord->listObjectString[length],"%04X ",word);
+		}
+	}
+}
+
 void CreateListStringValue(LISTING_RECORD *listingRecord,int value,bool unresolved)
 // Create the listing output string for a value
 {
+	listingRecord->numListObjectBytes=0;				// this replaces any object code listed so far
 	if(!unresolved)
 	{
 		sprintf(listingRecord->listObjectString,"(%08X)",value);
@@ -213,13 +387,32 @@ void CreateListStringValue(LISTING_RECORD *listingRecord,int value,bool unresolv
 	}
 }
 
+void CreateListFileTimeLine(char *line)
+// Make the first line of a listing (which says when it was assembled) in line,
+// which must hold MAX_STRING bytes
+// NOTE: the line is made without its line end
+{
+	time_t
+		timeVal;
+	char
+		timeString[26];						// TimeString wants at least 26 bytes
+
+	timeVal=time(NULL);
+	TimeString(&timeVal,timeString);
+	timeString[strcspn(timeString,"\n")]='\0';
+	snprintf(line,MAX_STRING,"tpasm %s		Assembling on %s",VERSION,timeString);
+}
+
 void OutputListFileHeader(time_t timeVal)
 // Dump the header information to the list file
 {
+	char
+		timeLine[MAX_STRING];
+
 	if(listFile)
 	{
-		timeVal=time(NULL);
-		fprintf(listFile,"tpasm %s		Assembling on %s",VERSION,ctime(&timeVal));
+		CreateListFileTimeLine(timeLine);
+		fprintf(listFile,"%s\n",timeLine);
 		fprintf(listFile,"\n");
 		fprintf(listFile,"Source File: %s\n",sourceFileName);
 		fprintf(listFile,"\n");
@@ -267,6 +460,7 @@ void OutputListFileLine(LISTING_RECORD *listingRecord,const char *sourceLine)
 // NOTE: this may generate more than one line if listingRecord->listObjectString is long
 // the string will be wrapped (preferably on space boundaries) and written on
 // subsequent lines
+// NOTE: object code held by the record is only formatted here
 {
 	unsigned int
 		startIndex,
@@ -274,6 +468,10 @@ void OutputListFileLine(LISTING_RECORD *listingRecord,const char *sourceLine)
 
 	if(!intermediatePass&&listFile&&outputListing&&listingRecord->wantList)
 	{
+		if(listingRecord->numListObjectBytes)
+		{
+			FormatListObjectBytes(listingRecord);
+		}
 		startIndex=0;
 		GetNextWrapIndex(listingRecord->listObjectString,&startIndex,&endIndex);
 		fprintf(listFile,"%-5d %08X %-14.*s %c	%s\n",listingRecord->lineNumber,listingRecord->listPC,endIndex-startIndex,&listingRecord->listObjectString[startIndex],listingRecord->sourceType,sourceLine);
@@ -328,19 +526,6 @@ void OutputListFileSegments()
 	}
 }
 
-static int CompareLabels(const void *i,const void *j)
-// compare the labels given by the entries i and j
-// This is called by qsort
-{
-	LABEL_RECORD
-		**recordA,
-		**recordB;
-
-	recordA=(LABEL_RECORD **)i;
-	recordB=(LABEL_RECORD **)j;
-	return(strcmp(STNodeName((*recordA)->symbol),STNodeName((*recordB)->symbol)));
-}
-
 bool OutputTextSymbols(FILE *file)
 // Dump symbol information in a textual way to file
 {
@@ -352,18 +537,8 @@ bool OutputTextSymbols(FILE *file)
 	LABEL_RECORD
 		**sortArray;
 
-	numLabels=NumLabels();
-	if((sortArray=(LABEL_RECORD **)NewPtr(sizeof(LABEL_RECORD *)*numLabels)))
+	if((sortArray=CreateSortedLabelArray(&numLabels)))
 	{
-		label=labelsHead;
-		for(i=0;i<numLabels;i++)		// make array of pointers to labels
-		{
-			sortArray[i]=label;
-			label=label->next;
-		}
-
-		qsort(sortArray,numLabels,sizeof(LABEL_RECORD *),CompareLabels);	// sort the array
-
 		fprintf(file,"Symbol Table Listing\n");
 		fprintf(file,"Value    U Name\n");
 		fprintf(file,"-------- - ----\n");
@@ -14,11 +14,17 @@
 //	along with tpasm; see the file "LICENSE.TXT".
 
 
+void SetMessageFile(FILE *file);
+FILE *GetMessageFile();
+void SetMessageCapture(MESSAGE_CAPTURE *capture,void *captureData);
 void ReportDiagnostic(const char *format,...);
 void ReportComplaint(bool isError,const char *format,...);
 void AssemblyComplaint(WHERE_FROM *whereFrom,bool isError,const char *format,...);
 void AssemblySupplement(WHERE_FROM *whereFrom,const char *format,...);
+void AddListObjectBytes(LISTING_RECORD *listingRecord,const unsigned char *bytes,unsigned int numBytes);
+void AddListObjectWord(LISTING_RECORD *listingRecord,unsigned int word);
 void CreateListStringValue(LISTING_RECORD *listingRecord,int value,bool unresolved);
+void CreateListFileTimeLine(char *line);
 void OutputListFileHeader(time_t timeVal);
 void OutputListFileLine(LISTING_RECORD *listingRecord,const char *sourceLine);
 void OutputListFileStats(unsigned int totalTime);
@@ -18,27 +18,68 @@
 
 #include	"include.h"
 
-static SYM_TABLE
+#define	MIN_TEXT_LINE_BYTES		16			// line space of the smallest size class of text line records
+#define	NUM_TEXT_LINE_CLASSES	9			// size classes of text line records (each holds twice what the one before does, up to MAX_STRING)
+
+static ASSEMBLY_STATE SYM_TABLE
 	*macroSymbols;											// macro symbol list is kept here
+static ASSEMBLY_STATE TEXT_LINE
+	*freeTextLines[NUM_TEXT_LINE_CLASSES];					// destroyed lines by size class, kept to be used again (they belong to the pass arena)
+
+static unsigned int TextLineClass(unsigned int lineBytes)
+// Return the smallest size class of text line record with room for lineBytes
+// (NUM_TEXT_LINE_CLASSES if none is big enough)
+{
+	unsigned int
+		lineClass;
+
+	lineClass=0;
+	while(lineClass<NUM_TEXT_LINE_CLASSES&&((unsigned int)MIN_TEXT_LINE_BYTES<<lineClass)<lineBytes)
+	{
+		lineClass++;
+	}
+	return(lineClass);
+}
 
 void DestroyTextBlockLines(TEXT_BLOCK *block)
+// get rid of the lines of block
+// The records are kept to be used again by AddLineToTextBlock, so blocks which are
+// made and destroyed over and over (macro parameters, repeats) do not grow the pass arena
 {
 	TEXT_LINE
 		*tempLine;
 
-	while(block->firstLine)								// get rid of lines of text
+	while(block->firstLine)
 	{
 		tempLine=block->firstLine->next;
-		DisposePtr(block->firstLine);
+		if(block->firstLine->lineClass<NUM_TEXT_LINE_CLASSES)	// records too big for any class were made to fit, and are left for the arena
+		{
+			block->firstLine->next=freeTextLines[block->firstLine->lineClass];
+			freeTextLines[block->firstLine->lineClass]=block->firstLine;
+		}
 		block->firstLine=tempLine;
 	}
+	block->lastLine=NULL;
+}
+
+void ForgetTextLines()
+// The pass arena is about to be reset, taking the kept text line records with it
+{
+	unsigned int
+		i;
+
+	for(i=0;i<NUM_TEXT_LINE_CLASSES;i++)
+	{
+		freeTextLines[i]=NULL;
+	}
 }
 
 bool AddLineToTextBlock(TEXT_BLOCK *block,const char *line)
 // Add line to block
 {
 	unsigned int
-		length;
+		length,
+		lineClass;
 	bool
 		fail;
 	TEXT_LINE
@@ -46,11 +87,21 @@ bool AddLineToTextBlock(TEXT_BLOCK *block,const char *line)
 
 	fail=false;
 	length=strlen(line);
-	if((textLine=(TEXT_LINE *)NewPtr(sizeof(TEXT_LINE)+length+1)))
+	lineClass=TextLineClass(length+1);
+	if(lineClass<NUM_TEXT_LINE_CLASSES&&(textLine=freeTextLines[lineClass]))
+	{
+		freeTextLines[lineClass]=textLine->next;
+	}
+	else
+	{
+		textLine=(TEXT_LINE *)ArenaNewPtr(passArena,sizeof(TEXT_LINE)+(lineClass<NUM_TEXT_LINE_CLASSES?(MIN_TEXT_LINE_BYTES<<lineClass):length+1));
+	}
+	if(textLine)
 	{
 		textLine->next=NULL;
 		textLine->whereFrom.file=currentVirtualFile;
 		textLine->whereFrom.fileLineNumber=currentVirtualFileLine;
+		textLine->lineClass=lineClass;
 		strcpy(&textLine->line[0],line);
 		if(block->lastLine)
 		{
@@ -132,61 +183,51 @@ MACRO_RECORD *LocateMacro(const char *name)
 	return(NULL);
 }
 
-bool AttemptMacro(const char *line,unsigned int *lineIndex,LISTING_RECORD *listingRecord,bool *success)
-// See if the next thing on the line looks like a macro invocation, if so, handle it.
-// If this matches anything, it will set success true.
+MACRO_RECORD *MatchMacro(const char *name)
+// See if name (ignoring case) is the name of a macro. Return its record if found, NULL if not.
+{
+	return((MACRO_RECORD *)STFindDataForNameNoCase(macroSymbols,name));
+}
+
+bool InvokeMacro(MACRO_RECORD *macro,const char *line,unsigned int *lineIndex,LISTING_RECORD *listingRecord)
+// The name of macro has been parsed from line, and lineIndex is just past it.
+// Collect the parameters from the rest of the line, and expand the macro.
 // If there's some sort of hard failure, this will return false
 {
 	bool
 		result;
-	unsigned int
-		tempIndex;
-	char
-		string[MAX_STRING];
-	MACRO_RECORD
-		*record;
 	TEXT_BLOCK
 		paramValues;
 
-	result=true;			// assume no hard failure
-	*success=false;			// so far, no macro matched
-	tempIndex=*lineIndex;
-	if(ParseName(line,&tempIndex,string))						// something that looks like a macro?
+	paramValues.firstLine=paramValues.lastLine=NULL;
+	if((result=CreateParameterList(line,lineIndex,&paramValues)))
 	{
-		if((record=(MACRO_RECORD *)STFindDataForNameNoCase(macroSymbols,string)))
+		if(ParseComment(line,lineIndex))
 		{
-			*lineIndex=tempIndex;								// actually push forward on the line
-			*success=true;
+			listingRecord->sourceType='m';				// output a small 'm' on lines which invoke a macro
+			OutputListFileLine(listingRecord,line);		// output the line first so that the macro contents follow it
+			listingRecord->wantList=false;
 
-			paramValues.firstLine=paramValues.lastLine=NULL;
-			if((result=CreateParameterList(line,lineIndex,&paramValues)))
-			{
-				if(ParseComment(line,lineIndex))
-				{
-					listingRecord->sourceType='m';				// output a small 'm' on lines which invoke a macro
-					OutputListFileLine(listingRecord,line);		// output the line first so that the macro contents follow it
-					listingRecord->wantList=false;
-
-					result=ProcessTextBlock(&record->contents,&record->parameters,&paramValues,'M');	// process text of macro back into assembly stream
-				}
-				else
-				{
-					AssemblyComplaint(NULL,true,"Ill formed macro parameters\n");
-				}
-			}
-			DestroyTextBlockLines(&paramValues);
+			result=ProcessTextBlock(&macro->contents,&macro->parameters,&paramValues,'M');	// process text of macro back into assembly stream
+		}
+		else
+		{
+			AssemblyComplaint(NULL,true,"Ill formed macro parameters\n");
 		}
 	}
+	DestroyTextBlockLines(&paramValues);
 	return(result);
 }
 
 void DestroyMacro(MACRO_RECORD *macro)
 // remove macro from existence
+// NOTE: the record is in the pass arena, so its memory goes when the arena is reset
 {
 	DestroyTextBlockLines(&macro->parameters);
 	DestroyTextBlockLines(&macro->contents);
 
 	STRemoveEntry(macroSymbols,macro->symbol);
+	MacrosChanged();
 
 	if(macro->next)
 	{
@@ -201,7 +242,6 @@ void DestroyMacro(MACRO_RECORD *macro)
 	{
 		macrosHead=macro->next;
 	}
-	DisposePtr(macro);
 }
 
 void DestroyMacros()
@@ -219,7 +259,7 @@ MACRO_RECORD *CreateMacro(char *macroName)
 	MACRO_RECORD
 		*record;
 
-	if((record=(MACRO_RECORD *)NewPtr(sizeof(MACRO_RECORD))))
+	if((record=(MACRO_RECORD *)ArenaNewPtr(passArena,sizeof(MACRO_RECORD))))
 	{
 		record->parameters.firstLine=NULL;
 		record->parameters.lastLine=NULL;
@@ -236,9 +276,9 @@ MACRO_RECORD *CreateMacro(char *macroName)
 				record->next->previous=record;	// make reverse link
 			}
 			macrosHead=record;
+			MacrosChanged();
 			return(record);
 		}
-		DisposePtr(record);
 	}
 	return(NULL);
 }
@@ -252,7 +292,8 @@ void UnInitMacros()
 bool InitMacros()
 // initialize symbol table for macros
 {
-	if((macroSymbols=STNewSymbolTable(0)))
+	ForgetTextLines();
+	if((macroSymbols=STNewArenaSymbolTable(0,passArena)))
 	{
 		return(true);
 	}
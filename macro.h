@@ -15,11 +15,13 @@
 
 
 void DestroyTextBlockLines(TEXT_BLOCK *block);
+void ForgetTextLines();
 bool AddLineToTextBlock(TEXT_BLOCK *block,const char *line);
 bool CreateParameterList(const char *line,unsigned int *lineIndex,TEXT_BLOCK *block);
 bool CreateParameterNames(const char *line,unsigned int *lineIndex,TEXT_BLOCK *block);
 MACRO_RECORD *LocateMacro(const char *name);
-bool AttemptMacro(const char *line,unsigned int *lineIndex,LISTING_RECORD *listingRecord,bool *result);
+MACRO_RECORD *MatchMacro(const char *name);
+bool InvokeMacro(MACRO_RECORD *macro,const char *line,unsigned int *lineIndex,LISTING_RECORD *listingRecord);
 void DestroyMacro(MACRO_RECORD *macro);
 void DestroyMacros();
 MACRO_RECORD *CreateMacro(char *macroName);
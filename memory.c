@@ -15,14 +15,63 @@
 
 
 // memory allocation routines
+// Besides single pointers, memory can be taken from arenas. An arena hands out
+// pieces of large blocks, and gets them all back at once when it is reset, so
+// records which all live for the same time (for instance, until the end of a pass)
+// cost nothing to throw away. The blocks are kept when an arena is reset, so
+// later passes reuse them.
 
 #include	"include.h"
 
+#define	ARENA_ALIGN				16		// every piece handed out by an arena starts on a multiple of this
+#define	ARENA_HEADER_SIZE		((sizeof(ARENA_BLOCK)+ARENA_ALIGN-1)&~(ARENA_ALIGN-1))
+#define	PASS_ARENA_BLOCK_SIZE	65536
+#define	BUILD_ARENA_BLOCK_SIZE	16384
+
+struct ARENA_BLOCK
+{
+	ARENA_BLOCK
+		*next;							// next block of the arena (NULL if none)
+	unsigned int
+		size,							// number of bytes this block can hand out
+		used;							// number handed out so far
+};
+
+struct MEMORY_ARENA
+{
+	ARENA_BLOCK
+		*firstBlock,
+		*lastBlock,
+		*currentBlock;					// block pieces are being taken from (NULL if none yet)
+	unsigned int
+		blockSize,						// size of blocks to allocate (larger pieces get a block of their own)
+		numPointers;					// number of pieces handed out since the arena was last reset
+};
+
+static ASSEMBLY_STATE bool
+	sharedAllocations;					// set while this thread is making or disposing of tables shared by all assemblies
+
+void SetSharedAllocations(bool shared)
+// While shared is set, pointers made and disposed of by this thread belong to the tables
+// shared by all assemblies, so they are counted in numSharedPointers rather than against
+// the assembly being run by this thread
+// NOTE: the caller must make sure no other thread changes the shared tables at the same time
+{
+	sharedAllocations=shared;
+}
+
 void DisposePtr(void *pointer)
 // Free memory allocated by NewPtr
 {
 	free(pointer);
-	numAllocatedPointers--;
+	if(sharedAllocations)
+	{
+		numSharedPointers--;
+	}
+	else
+	{
+		numAllocatedPointers--;
+	}
 }
 
 void *NewPtr(unsigned int size)
@@ -35,7 +84,130 @@ void *NewPtr(unsigned int size)
 	result=malloc(size);
 	if(result)
 	{
-		numAllocatedPointers++;
+		if(sharedAllocations)
+		{
+			numSharedPointers++;
+		}
+		else
+		{
+			numAllocatedPointers++;
+		}
 	}
 	return(result);
 }
+
+void *ArenaNewPtr(MEMORY_ARENA *arena,unsigned int size)
+// allocate memory from arena, it lasts until the arena is reset
+// NOTE: every piece is counted in numAllocatedPointers until the arena is reset,
+// so leaks are tracked just as they are for NewPtr
+{
+	ARENA_BLOCK
+		*block;
+	unsigned int
+		blockSize;
+	void
+		*result;
+
+	size=(size+ARENA_ALIGN-1)&~(ARENA_ALIGN-1);
+	block=arena->currentBlock;
+	while(block&&block->used+size>block->size)		// blocks after the current one are empty
+	{
+		block=block->next;
+	}
+	if(!block)
+	{
+		blockSize=Max(arena->blockSize,size);
+		if(!(block=(ARENA_BLOCK *)NewPtr(ARENA_HEADER_SIZE+blockSize)))
+		{
+			return(NULL);
+		}
+		block->next=NULL;
+		block->size=blockSize;
+		block->used=0;
+		if(arena->lastBlock)
+		{
+			arena->lastBlock->next=block;
+		}
+		else
+		{
+			arena->firstBlock=block;
+		}
+		arena->lastBlock=block;
+	}
+	arena->currentBlock=block;
+	result=(unsigned char *)block+ARENA_HEADER_SIZE+block->used;
+	block->used+=size;
+	arena->numPointers++;
+	numAllocatedPointers++;
+	return(result);
+}
+
+void ResetArena(MEMORY_ARENA *arena)
+// give back everything which was allocated from arena
+// The blocks are kept, so they can be handed out again
+{
+	ARENA_BLOCK
+		*block;
+
+	block=arena->firstBlock;
+	while(block)
+	{
+		block->used=0;
+		block=block->next;
+	}
+	arena->currentBlock=arena->firstBlock;
+	numAllocatedPointers-=arena->numPointers;
+	arena->numPointers=0;
+}
+
+void DisposeArena(MEMORY_ARENA *arena)
+// get rid of arena, along with everything which was allocated from it
+{
+	ARENA_BLOCK
+		*block;
+
+	ResetArena(arena);
+	while((block=arena->firstBlock))
+	{
+		arena->firstBlock=block->next;
+		DisposePtr(block);
+	}
+	DisposePtr(arena);
+}
+
+MEMORY_ARENA *NewArena(unsigned int blockSize)
+// make an arena which allocates memory blockSize bytes at a time
+// If there is a problem, return NULL
+{
+	MEMORY_ARENA
+		*arena;
+
+	if((arena=(MEMORY_ARENA *)NewPtr(sizeof(MEMORY_ARENA))))
+	{
+		arena->firstBlock=arena->lastBlock=arena->currentBlock=NULL;
+		arena->blockSize=blockSize;
+		arena->numPointers=0;
+	}
+	return(arena);
+}
+
+void UnInitMemory()
+// undo what InitMemory did
+{
+	DisposeArena(buildArena);
+	DisposeArena(passArena);
+}
+
+bool InitMemory()
+// make the arenas used by an assembly
+{
+	if((passArena=NewArena(PASS_ARENA_BLOCK_SIZE)))
+	{
+		if((buildArena=NewArena(BUILD_ARENA_BLOCK_SIZE)))
+		{
+			return(true);
+		}
+		DisposeArena(passArena);
+	}
+	return(false);
+}
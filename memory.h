@@ -14,5 +14,12 @@
 //	along with tpasm; see the file "LICENSE.TXT".
 
 
+void SetSharedAllocations(bool shared);
 void DisposePtr(void *pointer);
 void *NewPtr(unsigned int size);
+void *ArenaNewPtr(MEMORY_ARENA *arena,unsigned int size);
+void ResetArena(MEMORY_ARENA *arena);
+void DisposeArena(MEMORY_ARENA *arena);
+MEMORY_ARENA *NewArena(unsigned int blockSize);
+void UnInitMemory();
+bool InitMemory();
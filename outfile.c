@@ -19,6 +19,10 @@
 // run time.
 
 #include	"include.h"
+#ifndef NO_THREADS
+#include	<pthread.h>
+#include	<unistd.h>
+#endif
 
 static OUTPUTFILE_TYPE
 	*topOutputFileType=NULL;		// list of symbol file types (created at run time)
@@ -36,36 +40,299 @@ struct OUTPUT_RECORD
 		outputName[1];				// variable length string which contains the file name to output to
 };
 
-static OUTPUT_RECORD
+#ifndef NO_THREADS
+
+struct OUTPUT_JOB
+{
+	OUTPUT_RECORD
+		*record;						// output file this job generates
+	bool
+		failed;							// set if the file could not be generated
+	char
+		*messages;						// messages reported while generating (each is a type byte, then the 0 terminated text)
+	unsigned int
+		messagesLength;
+};
+
+struct OUTPUT_JOBS
+{
+	pthread_mutex_t
+		mutex;							// protects nextJob
+	OUTPUT_JOB
+		*jobs;
+	unsigned int
+		numJobs,
+		nextJob;						// next job to be handed to a worker
+	THREAD_STATE
+		state;							// taken from the thread which made the assembly, and given to each worker
+};
+
+#endif
+
+static ASSEMBLY_STATE OUTPUT_RECORD
 	*firstOutputRecord,				// linked list of output records
 	*lastOutputRecord;
 
-bool DumpOutputFiles()
-// dump output files for each type requested
+static ASSEMBLY_STATE OUTPUT_COLLECTOR
+	*outputCollector;				// if not NULL, called to take the results of the assembly along with the output files
+static ASSEMBLY_STATE void
+	*outputCollectorData;
+
+void SetOutputCollector(OUTPUT_COLLECTOR *collector,void *collectorData)
+// Have collector called for each assembly this thread makes output for
+// (or, if collector is NULL, stop calling it)
+{
+	outputCollector=collector;
+	outputCollectorData=collectorData;
+}
+
+char *PutHexBytes(char *text,const unsigned char *bytes,unsigned int numBytes,unsigned int *checkSum)
+// Write numBytes bytes as upper case hex to text, adding each to checkSum
+// Return a pointer to the character after the last one written
+{
+	static const char
+		hexDigits[]="0123456789ABCDEF";
+	unsigned int
+		i;
+
+	for(i=0;i<numBytes;i++)
+	{
+		*text++=hexDigits[bytes[i]>>4];
+		*text++=hexDigits[bytes[i]&0x0F];
+		*checkSum+=bytes[i];
+	}
+	return(text);
+}
+
+const char *GetOutputFileName(unsigned int index)
+// Return the name of the index'th output file requested (NULL if there are not that many)
+{
+	OUTPUT_RECORD
+		*currentRecord;
+
+	currentRecord=firstOutputRecord;
+	while(currentRecord&&index--)
+	{
+		currentRecord=currentRecord->nextRecord;
+	}
+	return(currentRecord?&currentRecord->outputName[0]:NULL);
+}
+
+static bool GenerateOutputFile(OUTPUT_RECORD *record)
+// open the file for record, have its type generate it, and close it
 // if there is a problem, complain and return false
 {
 	bool
 		fail;
-	OUTPUT_RECORD
-		*currentRecord;
 	FILE
 		*file;
 
 	fail=false;
-	currentRecord=firstOutputRecord;
-	while(currentRecord&&!fail)
+	if((file=record->type->binary?OpenBinaryOutputFile(&record->outputName[0]):OpenTextOutputFile(&record->outputName[0])))
 	{
-		if((file=currentRecord->type->binary?OpenBinaryOutputFile(&currentRecord->outputName[0]):OpenTextOutputFile(&currentRecord->outputName[0])))
+		fail=!record->type->outputFileGenerateFunction(file);
+		if(!(record->type->binary?CloseBinaryOutputFile(file):CloseTextOutputFile(file)))
 		{
-			fail=!currentRecord->type->outputFileGenerateFunction(file);
-			currentRecord->type->binary?CloseBinaryOutputFile(file):CloseTextOutputFile(file);
+			fail=true;
 		}
-		else
+	}
+	else
+	{
+		fail=true;
+	}
+	return(!fail);
+}
+
+#ifndef NO_THREADS
+
+static void CaptureOutputMessage(void *captureData,unsigned int messageType,const char *fileName,unsigned int lineNumber,const char *message)
+// hold on to a message reported while generating an output file on a worker thread, so the
+// thread which made the assembly can report it (and count it, and list it) later
+// NOTE: this is malloc'd, not NewPtr'd, since it is freed on a different thread
+{
+	OUTPUT_JOB
+		*job;
+	unsigned int
+		length;
+	char
+		*messages;
+
+	job=(OUTPUT_JOB *)captureData;
+	length=strlen(message);
+	if((messages=(char *)realloc(job->messages,job->messagesLength+length+2)))
+	{
+		messages[job->messagesLength]=(char)messageType;
+		memcpy(&messages[job->messagesLength+1],message,length+1);
+		job->messages=messages;
+		job->messagesLength+=length+2;
+	}
+}
+
+static void *OutputWorker(void *jobsPointer)
+// Keep taking output files from the list and generating them until there are none left
+// NOTE: this runs on its own thread, so the parts of the assembly which the output
+// generators look at are copied into this thread's state first
+{
+	OUTPUT_JOBS
+		*jobs;
+	OUTPUT_JOB
+		*job;
+
+	jobs=(OUTPUT_JOBS *)jobsPointer;
+	RestoreThreadState(&jobs->state);
+	displayWarnings=true;				// everything is captured, the thread which made the assembly decides what to show
+	do
+	{
+		pthread_mutex_lock(&jobs->mutex);
+		job=(jobs->nextJob<jobs->numJobs)?&jobs->jobs[jobs->nextJob++]:NULL;
+		pthread_mutex_unlock(&jobs->mutex);
+		if(job)
 		{
-			fail=true;
+			SetMessageCapture(CaptureOutputMessage,job);
+			job->failed=!GenerateOutputFile(job->record);
 		}
+	} while(job);
+	SetMessageCapture(NULL,NULL);
+	return(NULL);
+}
+
+static void ReportOutputMessages(OUTPUT_JOB *job)
+// report the messages which were captured while job ran, and let them go
+{
+	unsigned int
+		index;
+
+	index=0;
+	while(index<job->messagesLength)
+	{
+		switch(job->messages[index])
+		{
+			case MT_ERROR:
+			case MT_WARNING:
+				ReportComplaint(job->messages[index]==MT_ERROR,"%s",&job->messages[index+1]);
+				break;
+			default:
+				AssemblySupplement(NULL,"%s",&job->messages[index+1]);
+				break;
+		}
+		index+=strlen(&job->messages[index+1])+2;
+	}
+	free(job->messages);
+}
+
+static bool GenerateOutputFilesInParallel(unsigned int numRecords,bool *started)
+// generate all of the output files, spreading them over as many threads as there are processors
+// if no threads could be started, return with started false, having generated nothing
+// if there is a problem, complain and return false
+{
+	OUTPUT_JOBS
+		jobs;
+	OUTPUT_RECORD
+		*currentRecord;
+	pthread_t
+		*workers;
+	unsigned int
+		numThreads,
+		numWorkers,
+		i;
+	bool
+		fail;
+
+	fail=false;
+	*started=false;
+	numThreads=Min((unsigned int)Max(sysconf(_SC_NPROCESSORS_ONLN),1),numRecords);
+	if(numThreads>1)
+	{
+		if((jobs.jobs=(OUTPUT_JOB *)NewPtr(numRecords*sizeof(OUTPUT_JOB))))
+		{
+			if((workers=(pthread_t *)NewPtr(numThreads*sizeof(pthread_t))))
+			{
+				currentRecord=firstOutputRecord;
+				for(i=0;i<numRecords;i++)
+				{
+					jobs.jobs[i].record=currentRecord;
+					jobs.jobs[i].failed=false;
+					jobs.jobs[i].messages=NULL;
+					jobs.jobs[i].messagesLength=0;
+					currentRecord=currentRecord->nextRecord;
+				}
+				pthread_mutex_init(&jobs.mutex,NULL);
+				jobs.numJobs=numRecords;
+				jobs.nextJob=0;
+				SaveThreadState(&jobs.state);
+				numWorkers=0;
+				while(numWorkers<numThreads&&!pthread_create(&workers[numWorkers],NULL,OutputWorker,&jobs))
+				{
+					numWorkers++;
+				}
+				if(numWorkers)
+				{
+					*started=true;
+					for(i=0;i<numWorkers;i++)
+					{
+						pthread_join(workers[i],NULL);
+					}
+					for(i=0;i<numRecords;i++)			// report in the order the files were requested
+					{
+						ReportOutputMessages(&jobs.jobs[i]);
+						if(jobs.jobs[i].failed)
+						{
+							fail=true;
+						}
+					}
+				}
+				pthread_mutex_destroy(&jobs.mutex);
+				DisposePtr(workers);
+			}
+			DisposePtr(jobs.jobs);
+		}
+	}
+	return(!fail);
+}
+
+#endif
+
+bool DumpOutputFiles()
+// dump output files for each type requested, then hand the results to the output collector if there is one
+// when more than one file is requested, they are generated at the same time on separate threads
+// if there is a problem, complain and return false
+{
+	bool
+		fail,
+		started;
+	OUTPUT_RECORD
+		*currentRecord;
+	unsigned int
+		numRecords;
+
+	fail=false;
+	numRecords=0;
+	currentRecord=firstOutputRecord;
+	while(currentRecord)
+	{
+		numRecords++;
 		currentRecord=currentRecord->nextRecord;
 	}
+	started=false;
+#ifndef NO_THREADS
+	if(numRecords>1)
+	{
+		fail=!GenerateOutputFilesInParallel(numRecords,&started);
+	}
+#endif
+	if(!started)								// one file, or no threads to be had, so make them here
+	{
+		currentRecord=firstOutputRecord;
+		while(currentRecord&&!fail)
+		{
+			fail=!GenerateOutputFile(currentRecord);
+			currentRecord=currentRecord->nextRecord;
+		}
+	}
+	if(!fail&&outputCollector)
+	{
+		fail=!outputCollector(outputCollectorData);
+	}
 	return(!fail);
 }
 
@@ -123,11 +390,24 @@ void UnInitOutputFileGenerate()
 		DisposePtr(currentRecord);
 		currentRecord=nextRecord;
 	}
-	STDisposeSymbolTable(outputFileTypeSymbols);
 }
 
 bool InitOutputFileGenerate()
 // initialize output file generation selection
+{
+	firstOutputRecord=lastOutputRecord=NULL;		// no symbol files to create
+	return(true);
+}
+
+void UnInitOutputFileTypes()
+// undo what InitOutputFileTypes did
+{
+	STDisposeSymbolTable(outputFileTypeSymbols);
+}
+
+bool InitOutputFileTypes()
+// create the table of output file types which can be selected
+// NOTE: this is done once, and the table is shared by all assemblies
 {
 	bool
 		fail;
@@ -135,7 +415,6 @@ bool InitOutputFileGenerate()
 		*type;
 
 	fail=false;
-	firstOutputRecord=lastOutputRecord=NULL;		// no symbol files to create
 	if((outputFileTypeSymbols=STNewSymbolTable(10)))
 	{
 		type=topOutputFileType;
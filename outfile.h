@@ -40,8 +40,13 @@ public:
 	~OUTPUTFILE_TYPE();
 };
 
+void SetOutputCollector(OUTPUT_COLLECTOR *collector,void *collectorData);
+char *PutHexBytes(char *text,const unsigned char *bytes,unsigned int numBytes,unsigned int *checkSum);
+const char *GetOutputFileName(unsigned int index);
 bool DumpOutputFiles();
 bool SelectOutputFileType(char *typeName,char *outputName);
 void UnInitOutputFileGenerate();
 bool InitOutputFileGenerate();
+void UnInitOutputFileTypes();
+bool InitOutputFileTypes();
 void DumpOutputFileTypeInformation(FILE *file);
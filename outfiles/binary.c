@@ -0,0 +1,254 @@
+//	Copyright (C) 1999-2012 Core Technologies.
+//
+//	This file is part of tpasm.
+//
+//	tpasm is free software; you can redistribute it and/or modify
+//	it under the terms of the tpasm LICENSE AGREEMENT.
+//
+//	tpasm is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	tpasm LICENSE AGREEMENT for more details.
+//
+//	You should have received a copy of the tpasm LICENSE AGREEMENT
+//	along with tpasm; see the file "LICENSE.TXT".
+
+
+// Dump segments out as a flat binary image
+// The image runs from the lowest used address to the highest (or over the
+// window given with -window). Addresses which hold nothing are filled with
+// the byte given with -fill.
+
+#include	"include.h"
+
+#define	SPARSE_GAP			65536		// when the fill is 0, runs of fill at least this long are seeked over, leaving holes in the file
+#define	MAX_SEEK			0x40000000	// longest seek made at once
+
+struct BINARY_PAGE
+{
+	CODE_PAGE
+		*page;
+	unsigned int
+		order;							// order the page was found in (so pages at the same address stay in segment order)
+};
+
+static int ComparePages(const void *i,const void *j)
+// compare the pages given by the entries i and j
+// This is called by qsort
+{
+	const BINARY_PAGE
+		*pageA,
+		*pageB;
+
+	pageA=(const BINARY_PAGE *)i;
+	pageB=(const BINARY_PAGE *)j;
+	if(pageA->page->address!=pageB->page->address)
+	{
+		return(pageA->page->address<pageB->page->address?-1:1);
+	}
+	return(pageA->order<pageB->order?-1:1);
+}
+
+static inline bool ByteUsed(CODE_PAGE *page,unsigned int index)
+{
+	return((page->usageMap[index>>3]&(1<<(index&7)))!=0);
+}
+
+static bool DumpFill(FILE *file,unsigned long long length,bool atEnd)
+// Write length bytes of fill to file
+// If the fill is 0, and there is a lot of it, seek over it instead, so the file
+// is left with a hole. At the end of the image, the last byte is always written,
+// so the file comes out the right length.
+// Pipes and devices which can not seek are given the fill bytes instead.
+// If there is a problem, complain and return false
+{
+	unsigned char
+		buffer[4096];
+	unsigned long long
+		seekLength;
+	size_t
+		chunk;
+
+	if(!binaryFill&&length>=SPARSE_GAP&&!fseek(file,0,SEEK_CUR))
+	{
+		seekLength=atEnd?length-1:length;
+		length-=seekLength;
+		while(seekLength)
+		{
+			chunk=(size_t)Min(seekLength,(unsigned long long)MAX_SEEK);
+			if(fseek(file,(long)chunk,SEEK_CUR))
+			{
+				ReportComplaint(true,"Failed to seek in binary output file\nOS Reports: %s\n",strerror(errno));
+				return(false);
+			}
+			seekLength-=chunk;
+		}
+	}
+	memset(buffer,binaryFill,sizeof(buffer));
+	while(length)
+	{
+		chunk=(size_t)Min(length,(unsigned long long)sizeof(buffer));
+		fwrite(buffer,1,chunk,file);
+		length-=chunk;
+	}
+	return(true);
+}
+
+static unsigned int GatherPages(BINARY_PAGE *pages)
+// Fill in pages (if it is not NULL) with every page of every segment which generates output
+// Return the number of pages
+{
+	SEGMENT_RECORD
+		*segment;
+	CODE_PAGE
+		*page;
+	unsigned int
+		numPages;
+
+	numPages=0;
+	segment=segmentsHead;
+	while(segment)
+	{
+		if(segment->generateOutput)
+		{
+			page=segment->firstPage;
+			while(page)
+			{
+				if(pages)
+				{
+					pages[numPages].page=page;
+					pages[numPages].order=numPages;
+				}
+				numPages++;
+				page=page->next;
+			}
+		}
+		segment=segment->next;
+	}
+	return(numPages);
+}
+
+static void GetImageRange(BINARY_PAGE *pages,unsigned int numPages,unsigned long long *startAddress,unsigned long long *endAddress)
+// Work out the addresses the image covers (endAddress is one past the last)
+// NOTE: pages must be in address order
+{
+	unsigned int
+		i,j;
+	bool
+		found;
+
+	if(binaryWindow)
+	{
+		*startAddress=binaryWindowStart;
+		*endAddress=(unsigned long long)binaryWindowEnd+1;
+	}
+	else
+	{
+		*startAddress=*endAddress=0;
+		found=false;
+		for(i=0;i<numPages;i++)
+		{
+			for(j=0;j<256;j++)
+			{
+				if(ByteUsed(pages[i].page,j))
+				{
+					if(!found)								// the first used byte is the lowest
+					{
+						*startAddress=pages[i].page->address+j;
+						found=true;
+					}
+					*endAddress=Max(*endAddress,(unsigned long long)pages[i].page->address+j+1);
+				}
+			}
+		}
+	}
+}
+
+static bool OutputBinary(FILE *file)
+// Write all segments which generate output to file as one flat image
+// Where segments overlap, the bytes of the first one listed win
+// If there is a problem, complain and return false
+{
+	BINARY_PAGE
+		*pages;
+	unsigned int
+		numPages,
+		i,j,k;
+	unsigned long long
+		startAddress,
+		endAddress,
+		position,
+		pageAddress,
+		runStart,
+		runEnd;
+	unsigned char
+		pageData[256];
+	bool
+		pageUsed[256];
+	bool
+		fail;
+
+	numPages=GatherPages(NULL);
+	if((pages=(BINARY_PAGE *)NewPtr(sizeof(BINARY_PAGE)*(numPages?numPages:1))))
+	{
+		GatherPages(pages);
+		qsort(pages,numPages,sizeof(BINARY_PAGE),ComparePages);	// put the pages of all segments in address order
+		GetImageRange(pages,numPages,&startAddress,&endAddress);
+		position=startAddress;
+		fail=false;
+		i=0;
+		while(!fail&&i<numPages)
+		{
+			pageAddress=pages[i].page->address;
+			memset(pageUsed,0,sizeof(pageUsed));
+			while(i<numPages&&pages[i].page->address==pageAddress)	// merge all pages at this address
+			{
+				for(j=0;j<256;j++)
+				{
+					if(!pageUsed[j]&&ByteUsed(pages[i].page,j))
+					{
+						pageData[j]=pages[i].page->pageData[j];
+						pageUsed[j]=true;
+					}
+				}
+				i++;
+			}
+			j=0;
+			while(j<256)
+			{
+				while(j<256&&!pageUsed[j])				// skip over empty space
+				{
+					j++;
+				}
+				k=j;
+				while(k<256&&pageUsed[k])				// count up used space
+				{
+					k++;
+				}
+				runStart=Max(pageAddress+j,position);	// anything before position is outside the window
+				runEnd=Min(pageAddress+k,endAddress);
+				if(!fail&&runStart<runEnd)
+				{
+					fail=!DumpFill(file,runStart-position,false);
+					fwrite(&pageData[runStart-pageAddress],1,(size_t)(runEnd-runStart),file);
+					position=runEnd;
+				}
+				j=k;
+			}
+		}
+		if(!fail&&position<endAddress)
+		{
+			fail=!DumpFill(file,endAddress-position,true);
+		}
+		DisposePtr(pages);
+		return(!fail);
+	}
+	ReportComplaint(true,"Failed to allocate binary image pages\n");
+	return(false);
+}
+
+// output file types handled here (the constuctors for these variables link them to the global
+// list of output file types that the assembler knows how to handle)
+
+static OUTPUTFILE_TYPE
+	outputFileType("binary","Flat binary image (see -fill and -window)",true,OutputBinary);
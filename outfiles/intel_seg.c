@@ -22,33 +22,37 @@
 #define EXTADDRESS			2	// gets an extra 4 bits of address (idiotic segment concept)
 #define EXTLINEARADDRESS	4	// gets an extra 16 bits of address
 
-static unsigned int
+static ASSEMBLY_STATE unsigned int
 	lastAddressHigh;			// keeps track of the upper 16 bits of address when dumping intel hex records
 
 
-static void DumpGenericLine(FILE *file,unsigned int address,unsigned char recordType,unsigned char *bytes,unsigned int numBytes)
+static void DumpGenericLine(FILE *file,unsigned int address,unsigned char recordType,const unsigned char *bytes,unsigned int numBytes)
 // Create a line of intel hex output to file
+// The line is built in memory, and written all at once
 {
+	char
+		line[1+(4+255+1)*2+1],
+		*text;
+	unsigned char
+		header[4];
+	unsigned char
+		checkByte;
 	unsigned int
 		checkSum;
-	unsigned int
-		i;
 
-	fprintf(file,":%02X%04X%02X",numBytes,address&0xFFFF,recordType);
+	header[0]=numBytes;
+	header[1]=address>>8;
+	header[2]=address;
+	header[3]=recordType;
 	checkSum=0;
-	for(i=0;i<numBytes;i++)
-	{
-		checkSum+=bytes[i];
-		fprintf(file,"%02X",bytes[i]);
-	}
-	checkSum+=(address&0xFF)+((address>>8)&0xFF)+numBytes+recordType;
-	fprintf(file,"%02X\n",(-checkSum)&0xFF);
-}
-
-static void DumpLine(FILE *file,unsigned int address,unsigned char *bytes,unsigned int numBytes)
-// Create a line of intel hex output to file
-{
-	DumpGenericLine(file,address,DATARECORD,bytes,numBytes);
+	text=line;
+	*text++=':';
+	text=PutHexBytes(text,header,4,&checkSum);
+	text=PutHexBytes(text,bytes,numBytes,&checkSum);
+	checkByte=-checkSum;
+	text=PutHexBytes(text,&checkByte,1,&checkSum);
+	*text++='\n';
+	fwrite(line,1,text-line,file);
 }
 
 void DumpLinearAddress(FILE *file,unsigned int address)
@@ -62,57 +66,23 @@ void DumpLinearAddress(FILE *file,unsigned int address)
 	DumpGenericLine(file,0,EXTLINEARADDRESS,extendedAddressBuffer,2);
 }
 
-void DumpEOR(FILE *file)
-// Dump an end of record marker out to file
+static void DumpLine(FILE *file,unsigned int address,const unsigned char *bytes,unsigned int numBytes)
+// Create a line of intel hex output to file, preceded by a linear address
+// extension record if the upper address bits have changed
+// NOTE: records never cross a 64K boundary, so this only needs to be checked at the start
 {
-	DumpGenericLine(file,0,ENDRECORD,NULL,0);
+	if((address&0xFFFF0000)!=lastAddressHigh)
+	{
+		lastAddressHigh=address&0xFFFF0000;		// remember the last high address bits
+		DumpLinearAddress(file,lastAddressHigh);	// spit out upper address bits
+	}
+	DumpGenericLine(file,address,DATARECORD,bytes,numBytes);
 }
 
-static void DumpSegment(FILE *file,SEGMENT_RECORD *segment)
-// create a hex dump of segment to file
-// NOTE: this is careful to dump only the bytes which are marked as used
-// within segment
-// if segment is marked as not generating output, nothing will be dumped
+void DumpEOR(FILE *file)
+// Dump an end of record marker out to file
 {
-	CODE_PAGE
-		*page;
-	unsigned int
-		i,j,k;
-
-	if(segment->generateOutput)
-	{
-		page=segment->firstPage;
-		while(page)
-		{
-			if((page->address&0xFFFF0000)!=lastAddressHigh)
-			{
-				lastAddressHigh=page->address&0xFFFF0000;		// remember the last high address bits
-				DumpLinearAddress(file,lastAddressHigh);	// spit out upper address bits
-			}
-			for(i=0;i<256;i+=16)
-			{
-				j=0;
-				while(j<16)
-				{
-					while(j<16&&!(page->usageMap[(i+j)>>3]&(1<<(j&7))))	// skip over empty space
-					{
-						j++;
-					}
-					if(j<16)
-					{
-						k=j;
-						while(k<16&&(page->usageMap[(i+k)>>3]&(1<<(k&7))))	// count up used space
-						{
-							k++;
-						}
-						DumpLine(file,page->address+i+j,&page->pageData[i+j],k-j);	// dump out used bytes
-						j=k;												// move forward
-					}
-				}
-			}
-			page=page->next;
-		}
-	}
+	DumpGenericLine(file,0,ENDRECORD,NULL,0);
 }
 
 static bool OutputSegments(FILE *file)
@@ -130,7 +100,10 @@ static bool OutputSegments(FILE *file)
 	segment=segmentsHead;
 	while(segment)
 	{
-		DumpSegment(file,segment);
+		if(segment->generateOutput)
+		{
+			DumpSegmentRecords(file,segment,hexRecordLength,DumpLine);
+		}
 		segment=segment->next;
 	}
 	DumpEOR(file);
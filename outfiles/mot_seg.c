@@ -17,59 +17,61 @@
 
 #include	"include.h"
 
-static int
+static ASSEMBLY_STATE int
 	dataRecordType,
 	endRecordType;
 
-static void DumpGenericLine(FILE *file,unsigned int address,unsigned char recordType,unsigned char *bytes,unsigned int numBytes)
-// Create a line of motorola hex output to file
+static unsigned int AddressBytes(unsigned char recordType)
+// return the number of address bytes held by records of recordType
 {
-	unsigned int
-		checkSum;
-	unsigned int
-		i;
-
-	checkSum=0;
 	switch(recordType)
 	{
-		case 0:		// all these types have 2 byte addresses
-		case 1:
-		case 4:
-		case 5:
-		case 6:
-		case 9:
-			fprintf(file,"S%d%02X%04X",recordType,numBytes+3,address&0xFFFF);
-			checkSum+=numBytes+3;
-			checkSum+=address&0xFF;
-			checkSum+=(address>>8)&0xFF;
-			break;
 		case 2:		// these have 3 byte addresses
 		case 8:
-			fprintf(file,"S%d%02X%06X",recordType,numBytes+4,address&0xFFFFFF);
-			checkSum+=numBytes+4;
-			checkSum+=address&0xFF;
-			checkSum+=(address>>8)&0xFF;
-			checkSum+=(address>>16)&0xFF;
-			break;
+			return(3);
 		case 3:		// these have 4 byte addresses
 		case 7:
-			fprintf(file,"S%d%02X%08X",recordType,numBytes+5,address);
-			checkSum+=numBytes+5;
-			checkSum+=address&0xFF;
-			checkSum+=(address>>8)&0xFF;
-			checkSum+=(address>>16)&0xFF;
-			checkSum+=(address>>24)&0xFF;
-			break;
+			return(4);
 	}
-	for(i=0;i<numBytes;i++)
+	return(2);		// the rest have 2 byte addresses
+}
+
+static void DumpGenericLine(FILE *file,unsigned int address,unsigned char recordType,const unsigned char *bytes,unsigned int numBytes)
+// Create a line of motorola hex output to file
+// The line is built in memory, and written all at once
+{
+	char
+		line[2+(1+4+255+1)*2+1],
+		*text;
+	unsigned char
+		header[5];
+	unsigned int
+		addressBytes,
+		i;
+	unsigned char
+		checkByte;
+	unsigned int
+		checkSum;
+
+	addressBytes=AddressBytes(recordType);
+	header[0]=numBytes+addressBytes+1;
+	for(i=0;i<addressBytes;i++)
 	{
-		checkSum+=bytes[i];
-		fprintf(file,"%02X",bytes[i]);
+		header[addressBytes-i]=address>>(i*8);
 	}
-	fprintf(file,"%02X\n",(~checkSum)&0xFF);
+	checkSum=0;
+	text=line;
+	*text++='S';
+	*text++='0'+recordType;
+	text=PutHexBytes(text,header,addressBytes+1,&checkSum);
+	text=PutHexBytes(text,bytes,numBytes,&checkSum);
+	checkByte=~checkSum;
+	text=PutHexBytes(text,&checkByte,1,&checkSum);
+	*text++='\n';
+	fwrite(line,1,text-line,file);
 }
 
-static void DumpLine(FILE *file,unsigned int address,unsigned char *bytes,unsigned int numBytes)
+static void DumpLine(FILE *file,unsigned int address,const unsigned char *bytes,unsigned int numBytes)
 // Create a line of motorola hex output to file
 {
 	DumpGenericLine(file,address,dataRecordType,bytes,numBytes);
@@ -81,48 +83,6 @@ static void DumpEOF(FILE *file)
 	DumpGenericLine(file,0,endRecordType,NULL,0);
 }
 
-static void DumpSegment(FILE *file,SEGMENT_RECORD *segment)
-// create a hex dump of segment to file
-// NOTE: this is careful to dump only the bytes which are marked as used
-// within segment
-// if segment is marked as not generating output, nothing will be dumped
-{
-	CODE_PAGE
-		*page;
-	unsigned int
-		i,j,k;
-
-	if(segment->generateOutput)
-	{
-		page=segment->firstPage;
-		while(page)
-		{
-			for(i=0;i<256;i+=16)
-			{
-				j=0;
-				while(j<16)
-				{
-					while(j<16&&!(page->usageMap[(i+j)>>3]&(1<<(j&7))))	// skip over empty space
-					{
-						j++;
-					}
-					if(j<16)
-					{
-						k=j;
-						while(k<16&&(page->usageMap[(i+k)>>3]&(1<<(k&7))))	// count up used space
-						{
-							k++;
-						}
-						DumpLine(file,page->address+i+j,&page->pageData[i+j],k-j);	// dump out used bytes
-						j=k;												// move forward
-					}
-				}
-			}
-			page=page->next;
-		}
-	}
-}
-
 static bool OutputSegments(FILE *file)
 // create a hex dump of all segments to file
 // NOTE: this is careful to dump only the bytes which are marked as used
@@ -133,11 +93,17 @@ static bool OutputSegments(FILE *file)
 {
 	SEGMENT_RECORD
 		*segment;
+	unsigned int
+		maxRecordLength;
 
+	maxRecordLength=Min(hexRecordLength,255-AddressBytes(dataRecordType)-1);	// the length byte counts the address and check sum too
 	segment=segmentsHead;
 	while(segment)
 	{
-		DumpSegment(file,segment);
+		if(segment->generateOutput)
+		{
+			DumpSegmentRecords(file,segment,maxRecordLength,DumpLine);
+		}
 		segment=segment->next;
 	}
 	DumpEOF(file);
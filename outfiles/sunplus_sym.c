@@ -16,19 +16,6 @@
 
 #include	"include.h"
 
-static int CompareLabels(const void *i,const void *j)
-// compare the labels given by the entries i and j
-// This is called by qsort
-{
-	LABEL_RECORD
-		**recordA,
-		**recordB;
-
-	recordA=(LABEL_RECORD **)i;
-	recordB=(LABEL_RECORD **)j;
-	return(strcmp(STNodeName((*recordA)->symbol),STNodeName((*recordB)->symbol)));
-}
-
 static bool OutputSymbols(FILE *file)
 // Dump symbol information in sunplus style
 {
@@ -43,19 +30,8 @@ static bool OutputSymbols(FILE *file)
 	unsigned int
 		moduleLength;
 
-	numLabels=NumLabels();
-
-	if((sortArray=(LABEL_RECORD **)NewPtr(sizeof(LABEL_RECORD *)*numLabels)))
+	if((sortArray=CreateSortedLabelArray(&numLabels)))	// sorted (not that it matters here)
 	{
-		label=labelsHead;
-		for(i=0;i<numLabels;i++)		// make array of pointers to labels
-		{
-			sortArray[i]=label;
-			label=label->next;
-		}
-
-		qsort(sortArray,numLabels,sizeof(LABEL_RECORD *),CompareLabels);	// sort the array (not that it matters here)
-
 
 		fputc(0xfe,file);						// start of Microtek symbol file (0xfe)
 
@@ -22,19 +22,6 @@
 // output file types handled here (the constuctors for these variables link them to the global
 // list of output file types that the assembler knows how to handle)
 
-static int CompareLbl(const void *i,const void *j)
-// compare the labels given by the entries i and j
-// This is called by qsort
-{
-	LABEL_RECORD
-		**recordA,
-		**recordB;
-
-	recordA=(LABEL_RECORD **)i;
-	recordB=(LABEL_RECORD **)j;
-	return(strcmp(STNodeName((*recordA)->symbol),STNodeName((*recordB)->symbol)));
-}
-
 bool GetTextSymbols(FILE *file)
 // Dump symbol information in a textual way to file
 {
@@ -46,18 +33,8 @@ bool GetTextSymbols(FILE *file)
 	LABEL_RECORD
 		**sortArray;
 
-	numLabels=NumLabels();
-	if((sortArray=(LABEL_RECORD **)NewPtr(sizeof(LABEL_RECORD *)*numLabels)))
+	if((sortArray=CreateSortedLabelArray(&numLabels)))
 	{
-		label=labelsHead;
-		for(i=0;i<numLabels;i++)		// make array of pointers to labels
-		{
-			sortArray[i]=label;
-			label=label->next;
-		}
-
-		qsort(sortArray,numLabels,sizeof(LABEL_RECORD *),CompareLbl);	// sort the array
-
 		for(i=0;i<numLabels;i++)		// make array of pointers to labels
 		{
 			label=sortArray[i];
@@ -240,15 +240,13 @@ bool ParseLabelString(const char *line,unsigned int *lineIndex,char *label,bool
 	*isLocal=false;
 	if(line[localIndex]=='.')				// see if local label
 	{
-		sprintf(label,"%s@",scope);
-		outputIndex=strlen(label);			// move to the end
+		outputIndex=CopyLocalLabelPrefix(label,false);
 		localIndex++;
 		*isLocal=true;
 	}
 	else if(line[localIndex]=='@')			// see if macro local label
 	{
-		sprintf(label,"%s@%d@",scope,scopeValue);
-		outputIndex=strlen(label);			// move to the end
+		outputIndex=CopyLocalLabelPrefix(label,true);
 		localIndex++;
 		*isLocal=true;
 	}
@@ -22,11 +22,19 @@
 // which supports it.
 
 #include	"include.h"
+#ifndef NO_THREADS
+#include	<pthread.h>
+#endif
 
 static PROCESSOR_FAMILY
 	*topProcessorFamily=NULL;		// list of processor families (created at run time)
 
-static PROCESSOR
+#ifndef NO_THREADS
+static pthread_mutex_t
+	familyMutex=PTHREAD_MUTEX_INITIALIZER;	// held while a family is initialized (assemblies on other threads may be selecting processors too)
+#endif
+
+static ASSEMBLY_STATE PROCESSOR
 	*currentProcessor;
 
 static SYM_TABLE
@@ -93,6 +101,39 @@ static bool AssignProcessorLabel(PROCESSOR *processor)
 	return(AssignSetConstant(labelName,1,true));
 }
 
+static bool InitProcessorFamily(PROCESSOR_FAMILY *family)
+// Make sure the family's tables have been made
+// Families are only initialized when one of their processors is first selected,
+// so nothing is done for families which are never used.
+// If there is a problem, complain and return false
+{
+	bool
+		fail;
+
+	fail=false;
+#ifndef NO_THREADS
+	pthread_mutex_lock(&familyMutex);
+#endif
+	if(!family->initialized)
+	{
+		SetSharedAllocations(true);		// the tables are shared by all assemblies, so they are not counted against this one
+		if(family->initFamilyFunction())
+		{
+			family->initialized=true;
+		}
+		else
+		{
+			ReportComplaint(true,"Failed to initialize processor family: %s\n",family->name);
+			fail=true;
+		}
+		SetSharedAllocations(false);
+	}
+#ifndef NO_THREADS
+	pthread_mutex_unlock(&familyMutex);
+#endif
+	return(!fail);
+}
+
 bool SelectProcessor(const char *processorName,bool *found)
 // select the processor based on the passed name
 // NOTE: if processorName is passed in as a zero length string,
@@ -131,11 +172,18 @@ bool SelectProcessor(const char *processorName,bool *found)
 		{
 			if((resultValue=STFindDataForName(processorSymbols,convertedName)))
 			{
-				currentProcessor=(PROCESSOR *)resultValue;
 				*found=true;
-				if(AssignProcessorLabel(currentProcessor))
+				if(InitProcessorFamily(((PROCESSOR *)resultValue)->family))
 				{
-					currentProcessor->family->selectProcessorFunction(currentProcessor);	// let this processor know it has been selected
+					currentProcessor=(PROCESSOR *)resultValue;
+					if(AssignProcessorLabel(currentProcessor))
+					{
+						currentProcessor->family->selectProcessorFunction(currentProcessor);	// let this processor know it has been selected
+					}
+					else
+					{
+						fail=true;
+					}
 				}
 				else
 				{
@@ -148,68 +196,20 @@ bool SelectProcessor(const char *processorName,bool *found)
 			*found=true;								// empty name can always be found
 		}
 	}
-	return(!fail);
-}
-
-static void UnInitProcessorFamily(PROCESSOR_FAMILY *family)
-// Uninitialize a processor family
-{
-	PROCESSOR
-		*processor;
-
-	processor=family->lastProcessor;
-	while(processor)
-	{
-		STRemoveEntry(processorSymbols,processor->symbol);
-		processor=processor->previousProcessor;
-	}
-	family->uninitFamilyFunction();
-}
-
-static bool InitProcessorFamily(PROCESSOR_FAMILY *family)
-// Call the processor family's init function, and add each
-// processor in the family's symbols to the table
-{
-	bool
-		fail;
-	PROCESSOR
-		*processor;
-
-	fail=false;
-	if(family->initFamilyFunction())
+	if(!SelectMnemonicTable(currentProcessor))			// line dispatch depends on the processor
 	{
-		processor=family->firstProcessor;
-		while(processor&&!fail)
-		{
-			if((processor->symbol=STAddEntryAtEnd(processorSymbols,processor->name,processor)))
-			{
-				processor=processor->nextProcessor;
-			}
-			else
-			{
-				fail=true;
-			}
-		}
-		if(!fail)
-		{
-			return(true);
-		}
-		processor=processor->previousProcessor;
-		while(processor)
-		{
-			STRemoveEntry(processorSymbols,processor->symbol);
-			processor=processor->previousProcessor;
-		}
-		family->uninitFamilyFunction();
+		fail=true;
 	}
-	return(false);
+	return(!fail);
 }
 
 void UnInitProcessors()
-// undo what InitProcessors did
+// undo what InitProcessors did (and un-initialize the families which were used)
 {
 	PROCESSOR_FAMILY
 		*family;
+	PROCESSOR
+		*processor;
 
 	family=topProcessorFamily;
 	while(family&&family->nextFamily)	// race to the bottom so we can un-init in reverse order
@@ -218,19 +218,34 @@ void UnInitProcessors()
 	}
 	while(family)
 	{
-		UnInitProcessorFamily(family);
+		processor=family->lastProcessor;
+		while(processor)
+		{
+			STRemoveEntry(processorSymbols,processor->symbol);
+			processor=processor->previousProcessor;
+		}
+		if(family->initialized)
+		{
+			SetSharedAllocations(true);	// these were counted as shared when they were made
+			family->uninitFamilyFunction();
+			SetSharedAllocations(false);
+			family->initialized=false;
+		}
 		family=family->previousFamily;
 	}
 	STDisposeSymbolTable(processorSymbols);
 }
 
 bool InitProcessors()
-// initialize symbol table for processor selection, and initialize all the processor family handler functions
+// initialize symbol table for processor selection
+// NOTE: the families themselves are initialized as their processors are selected
 {
 	bool
 		fail;
 	PROCESSOR_FAMILY
 		*family;
+	PROCESSOR
+		*processor;
 
 	currentProcessor=NULL;				// no processor chosen as current
 	fail=false;
@@ -239,32 +254,27 @@ bool InitProcessors()
 		family=topProcessorFamily;
 		while(family&&!fail)
 		{
-			if(InitProcessorFamily(family))
+			processor=family->firstProcessor;
+			while(processor&&!fail)
 			{
-				family=family->nextFamily;
-			}
-			else
-			{
-				ReportComplaint(true,"Failed to initialize processor family: %s\n",family->name);
-				fail=true;
+				if((processor->symbol=STAddEntryAtEnd(processorSymbols,processor->name,processor)))
+				{
+					processor=processor->nextProcessor;
+				}
+				else
+				{
+					fail=true;
+				}
 			}
+			family=family->nextFamily;
 		}
 		if(!fail)
 		{
 			return(true);
 		}
-		family=family->previousFamily;
-		while(family)
-		{
-			UnInitProcessorFamily(family);
-			family=family->previousFamily;
-		}
 		STDisposeSymbolTable(processorSymbols);
 	}
-	else
-	{
-		ReportComplaint(true,"Failed to create symbol table for processors\n");
-	}
+	ReportComplaint(true,"Failed to create symbol table for processors\n");
 	return(false);
 }
 
@@ -345,6 +355,8 @@ PROCESSOR_FAMILY::PROCESSOR_FAMILY(const char *processorName,InitFamilyFunction
 	firstProcessor=NULL;
 	lastProcessor=NULL;
 
+	initialized=false;
+
 	if((nextFamily=topProcessorFamily))				// link to next one
 	{
 		topProcessorFamily->previousFamily=this;	// link next one to this one
@@ -47,6 +47,9 @@ public:
 		*firstProcessor,		// keeps list of processors in this family
 		*lastProcessor;
 
+	bool
+		initialized;			// set once initFamilyFunction has been called (families are initialized when first selected)
+
 	PROCESSOR_FAMILY
 		*previousFamily,		// used to link the list of families together
 		*nextFamily;
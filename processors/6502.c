@@ -23,7 +23,7 @@ static SYM_TABLE
 	*opcode6502Symbols,
 	*opcode65C02Symbols;
 
-static PROCESSOR
+static ASSEMBLY_STATE PROCESSOR
 	*currentProcessor;
 
 // enumerated addressing modes
@@ -24,7 +24,7 @@ static SYM_TABLE
 	*opcodeSymbols6805,
 	*opcodeSymbols68hc08;
 
-static PROCESSOR
+static ASSEMBLY_STATE PROCESSOR
 	*currentProcessor;
 
 // enumerated addressing modes
@@ -514,11 +514,7 @@ static bool GenerateImmediate16(int value,bool unresolved,LISTING_RECORD *listin
 // if there is a hard failure, return false
 {
 	CheckWordRange(value,true,true);
-	if(GenerateByte(value>>8,listingRecord))
-	{
-		return(GenerateByte(value&0xFF,listingRecord));
-	}
-	return(false);
+	return(GenerateWord(value,listingRecord,true));
 }
 
 static bool GenerateDirectAddress(int value,bool unresolved,LISTING_RECORD *listingRecord)
@@ -534,11 +530,7 @@ static bool GenerateExtendedAddress(int value,bool unresolved,LISTING_RECORD *li
 // if there is a hard failure, return false
 {
 	CheckUnsignedWordRange(value,true,true);
-	if(GenerateByte(value>>8,listingRecord))
-	{
-		return(GenerateByte(value&0xFF,listingRecord));
-	}
-	return(false);
+	return(GenerateWord(value,listingRecord,true));
 }
 
 static bool GenerateRelativeOffset(int value,bool unresolved,LISTING_RECORD *listingRecord)
@@ -570,11 +562,7 @@ static bool GenerateOffset16(int value,bool unresolved,LISTING_RECORD *listingRe
 // if there is a hard failure, return false
 {
 	CheckWordRange(value,true,true);		// can be signed too, since address space is 16 bits
-	if(GenerateByte(value>>8,listingRecord))
-	{
-		return(GenerateByte(value&0xFF,listingRecord));
-	}
-	return(false);
+	return(GenerateWord(value,listingRecord,true));
 }
 
 // ----------------------------------------------------------------------------------------
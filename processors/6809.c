@@ -780,14 +780,7 @@ static bool HandleExtended(OPCODE *opcode,int value,bool unresolved,LISTING_RECO
 	CheckUnsignedWordRange(value,true,true);	// make sure the value is in range
 	if(WriteOpcode(opcode->baseOpcode[OT_EXTENDED],listingRecord))
 	{
-		if(GenerateByte(value>>8,listingRecord))
-		{
-			fail=!GenerateByte(value&0xFF,listingRecord);
-		}
-		else
-		{
-			fail=true;
-		}
+		fail=!GenerateWord(value,listingRecord,true);
 	}
 	else
 	{
@@ -956,14 +949,7 @@ static bool HandleImmediate16(OPCODE *opcode,int value,bool unresolved,LISTING_R
 	CheckWordRange(value,true,true);
 	if(WriteOpcode(opcode->baseOpcode[OT_IMMEDIATE16],listingRecord))
 	{
-		if(GenerateByte(value>>8,listingRecord))
-		{
-			fail=!GenerateByte(value&0xFF,listingRecord);
-		}
-		else
-		{
-			fail=true;
-		}
+		fail=!GenerateWord(value,listingRecord,true);
 	}
 	else
 	{
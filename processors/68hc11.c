@@ -397,11 +397,7 @@ static bool HandleImmediate(OPCODE *opcode,int value,bool unresolved,LISTING_REC
 		fail = !WriteOpcode(opcode->baseOpcode[OT_IMMEDIATE16],listingRecord);
 		if(!fail)
 		{
-			fail = !GenerateByte((value>>8)&0xff,listingRecord);
-			if(!fail)
-			{
-				fail = !GenerateByte(value&0xff,listingRecord);
-			}
+			fail = !GenerateWord(value,listingRecord,true);
 		}
 	}
 	else
@@ -36,7 +36,7 @@ struct PROCESSOR_DATA
 		memorySize;					// memory size of the given processor
 };
 
-static PROCESSOR_DATA
+static ASSEMBLY_STATE PROCESSOR_DATA
 	*currentProcessor;				// points at the record for the currently selected processor
 
 static SYM_TABLE
@@ -41,7 +41,7 @@ static SYM_TABLE
 	*opcodeTiny22Symbols;			// symbols for the extra opcodes in the ATtiny22
 
 
-static PROCESSOR
+static ASSEMBLY_STATE PROCESSOR
 	*currentProcessor;
 
 
@@ -901,8 +901,6 @@ static bool GenerateAVRWord(int wordValue,LISTING_RECORD *listingRecord)
 {
 	unsigned char
 		outputBytes[2];
-	unsigned int
-		length;
 	bool
 		fail;
 
@@ -913,11 +911,7 @@ static bool GenerateAVRWord(int wordValue,LISTING_RECORD *listingRecord)
 		{
 			if(!intermediatePass)				// only do the real work if necessary
 			{
-				length=strlen(listingRecord->listObjectString);
-				if(length+6<MAX_STRING)
-				{
-					sprintf(&listingRecord->listObjectString[length],"%04X ",wordValue);		// create list file output
-				}
+				AddListObjectWord(listingRecord,wordValue);		// create list file output
 				outputBytes[0]=wordValue&0xFF;	// data is written as little endian words
 				outputBytes[1]=wordValue>>8;
 
@@ -937,9 +931,9 @@ static bool GenerateAVRWord(int wordValue,LISTING_RECORD *listingRecord)
 	return(!fail);
 }
 
-static unsigned char
+static ASSEMBLY_STATE unsigned char
 	heldByte;
-static unsigned int
+static ASSEMBLY_STATE unsigned int
 	byteGenCounter;
 
 static void StartByteGeneration()
@@ -53,14 +53,14 @@ static SYM_TABLE
 	*pseudoOpcodeSymbols,
 	*opcodeSymbols;
 
-static PROCESSOR
+static ASSEMBLY_STATE PROCESSOR
 	*currentProcessor;
 
-static	bool	segmented;
-static	unsigned int	dpp0;
-static	unsigned int	dpp1;
-static	unsigned int	dpp2;
-static	unsigned int	dpp3;
+static	ASSEMBLY_STATE	bool	segmented;
+static	ASSEMBLY_STATE	unsigned int	dpp0;
+static	ASSEMBLY_STATE	unsigned int	dpp1;
+static	ASSEMBLY_STATE	unsigned int	dpp2;
+static	ASSEMBLY_STATE	unsigned int	dpp3;
 
 // register codes
 
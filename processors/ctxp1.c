@@ -520,8 +520,6 @@ static bool GenerateCTXP1Word(int wordValue,LISTING_RECORD *listingRecord)
 {
 	unsigned char
 		outputBytes[2];
-	unsigned int
-		length;
 	bool
 		fail;
 
@@ -532,11 +530,7 @@ static bool GenerateCTXP1Word(int wordValue,LISTING_RECORD *listingRecord)
 		{
 			if(!intermediatePass)				// only do the real work if necessary
 			{
-				length=strlen(listingRecord->listObjectString);
-				if(length+6<MAX_STRING)
-				{
-					sprintf(&listingRecord->listObjectString[length],"%04X ",wordValue);		// create list file output
-				}
+				AddListObjectWord(listingRecord,wordValue);		// create list file output
 				outputBytes[0]=wordValue>>8;		// data is written as big endian words
 				outputBytes[1]=wordValue&0xFF;
 
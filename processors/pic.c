@@ -49,16 +49,17 @@ struct PIC_PROCESSOR
 		IDLocAddress;				// address in which to store ID data for this processor (0 if invalid)
 };
 
-static PIC_PROCESSOR
+static ASSEMBLY_STATE PIC_PROCESSOR
 	*currentProcessor;				// points at the record for the currently selected processor
 
 #define	MAX_BAD_RAM	0x1000			// MAXRAM pseudo-op must have argument less than this
+#define	MAX_PIC_WORDS	4				// most program words GeneratePICWordsAtAddress writes in one go (the ID locations)
 
-static bool
+static ASSEMBLY_STATE bool
 	testBadRAM;						// tells if bad ram should be tested for
-static int
+static ASSEMBLY_STATE int
 	maxRAM;							// the value of maxRAM that was given
-static unsigned char
+static ASSEMBLY_STATE unsigned char
 	badRAMMap[MAX_BAD_RAM>>3];		// bitmap of bad RAM locations (tested when maxram is specified)
 
 enum
@@ -275,13 +276,12 @@ static bool GeneratePICWordsAtAddress(unsigned int address,unsigned int numWords
 // force word values out to memory starting at the given address
 {
 	unsigned char
-		outputBytes[2];
+		outputBytes[MAX_PIC_WORDS*2];
 	int
 		temp;
 	unsigned int
-		length;
-	unsigned int
-		i;
+		i,
+		numRun;
 	bool
 		fail;
 
@@ -292,24 +292,25 @@ static bool GeneratePICWordsAtAddress(unsigned int address,unsigned int numWords
 		{
 			listingRecord->listPC=address;				// change list output to show this address
 
-			for(i=0;!fail&&i<numWords;i++)
+			while(!fail&&numWords)
 			{
-				temp=wordValues[i];
-				if(temp&~currentProcessor->coreMask)	// see if word uses more bits than it should (if so, kill upper bits and generate warning)
+				numRun=Min(numWords,(unsigned int)MAX_PIC_WORDS);
+				for(i=0;i<numRun;i++)
 				{
-					AssemblyComplaint(NULL,false,"Program word too large. Truncated to core size. (%04X)\n",temp);
-					temp&=currentProcessor->coreMask;
-				}
-				length=strlen(listingRecord->listObjectString);
-				if(length+6<MAX_STRING)
-				{
-					sprintf(&listingRecord->listObjectString[length],"%04X ",temp);		// create list file output
+					temp=wordValues[i];
+					if(temp&~currentProcessor->coreMask)	// see if word uses more bits than it should (if so, kill upper bits and generate warning)
+					{
+						AssemblyComplaint(NULL,false,"Program word too large. Truncated to core size. (%04X)\n",temp);
+						temp&=currentProcessor->coreMask;
+					}
+					AddListObjectWord(listingRecord,temp);		// create list file output
+					outputBytes[i*2]=temp&0xFF;				// data is written as little endian words
+					outputBytes[i*2+1]=temp>>8;
 				}
-				outputBytes[0]=temp&0xFF;				// data is written as little endian words
-				outputBytes[1]=temp>>8;
-
-				fail=!AddBytesToSegment(currentSegment,address*2,outputBytes,2);	// each memory location is 16 bits wide
-				address++;
+				fail=!AddBytesToSegment(currentSegment,address*2,outputBytes,numRun*2);	// each memory location is 16 bits wide
+				address+=numRun;
+				wordValues+=numRun;
+				numWords-=numRun;
 			}
 		}
 	}
@@ -326,8 +327,6 @@ static bool GeneratePICWord(int wordValue,LISTING_RECORD *listingRecord)
 {
 	unsigned char
 		outputBytes[2];
-	unsigned int
-		length;
 	bool
 		fail;
 
@@ -343,11 +342,7 @@ static bool GeneratePICWord(int wordValue,LISTING_RECORD *listingRecord)
 					AssemblyComplaint(NULL,false,"Program word too large. Truncated to core size. (%04X)\n",wordValue);
 					wordValue&=currentProcessor->coreMask;
 				}
-				length=strlen(listingRecord->listObjectString);
-				if(length+6<MAX_STRING)
-				{
-					sprintf(&listingRecord->listObjectString[length],"%04X ",wordValue);		// create list file output
-				}
+				AddListObjectWord(listingRecord,wordValue);		// create list file output
 				outputBytes[0]=wordValue&0xFF;	// data is written as little endian words
 				outputBytes[1]=wordValue>>8;
 
@@ -367,9 +362,9 @@ static bool GeneratePICWord(int wordValue,LISTING_RECORD *listingRecord)
 	return(!fail);
 }
 
-static unsigned char
+static ASSEMBLY_STATE unsigned char
 	heldByte;
-static int
+static ASSEMBLY_STATE int
 	byteGenCounter;
 
 static void StartByteGeneration()
@@ -139,7 +139,7 @@ static SYM_TABLE
 	*opcodeSymbols,
 	*opcodeZ180Symbols;
 
-static PROCESSOR
+static ASSEMBLY_STATE PROCESSOR
 	*currentProcessor;
 
 
@@ -1033,17 +1033,11 @@ static OPCODE
 //
 static bool GenerateOpcode(unsigned short value, unsigned char opcodeLen, LISTING_RECORD *listingRecord)
 {
-	bool fail = false;
-
 	if(opcodeLen == 2)
 	{
-		fail = !GenerateByte((value>>8)&0xff,listingRecord);
+		return(GenerateWord(value,listingRecord,true));
 	}
-	if(!fail)
-	{
-		fail = !GenerateByte(value&0xff,listingRecord);
-	}
-	return(!fail);
+	return(GenerateByte(value&0xff,listingRecord));
 }
 
 
@@ -1727,30 +1727,18 @@ static bool HandleEnd(const char *opcodeName,const char *line,unsigned int *line
 	return(true);
 }
 
-bool AttemptGlobalPseudoOpcode(const char *line,unsigned int *lineIndex,const PARSED_LABEL *lineLabel,LISTING_RECORD *listingRecord,bool *success)
-// See if the next thing on the line looks like a global pseudo-op.
-// If this matches anything, it will set success true.
-// If there's some sort of hard failure, this will return false
+PSEUDO_OPCODE *MatchGlobalPseudoOpcode(const char *name)
+// See if name is a global pseudo-op (only the strict ones are checked if strictPseudo is set)
+// Return its record if so, NULL if not
 {
-	unsigned int
-		tempIndex;
-	char
-		string[MAX_STRING];
 	PSEUDO_OPCODE
 		*opcode;
 
-	*success=false;
-	tempIndex=*lineIndex;
-	if(ParseName(line,&tempIndex,string))						// something that looks like an opcode?
+	if((opcode=(PSEUDO_OPCODE *)STFindDataForNameNoCase(strictPseudoOpcodeSymbols,name))||((!strictPseudo)&&(opcode=(PSEUDO_OPCODE *)STFindDataForNameNoCase(loosePseudoOpcodeSymbols,name))))
 	{
-		if((opcode=(PSEUDO_OPCODE *)STFindDataForNameNoCase(strictPseudoOpcodeSymbols,string))||((!strictPseudo)&&(opcode=(PSEUDO_OPCODE *)STFindDataForNameNoCase(loosePseudoOpcodeSymbols,string))))			// matches global pseudo-op?
-		{
-			*success=true;										// remember we saw something
-			*lineIndex=tempIndex;								// actually push forward on the line
-			return(opcode->function(string,line,lineIndex,lineLabel,listingRecord));
-		}
+		return(opcode);
 	}
-	return(true);
+	return(NULL);
 }
 
 void UnInitGlobalPseudoOpcodes()
@@ -23,6 +23,6 @@ struct PSEUDO_OPCODE
 		*function;
 };
 
-bool AttemptGlobalPseudoOpcode(const char *line,unsigned int *lineIndex,const PARSED_LABEL *lineLabel,LISTING_RECORD *listingRecord,bool *success);
+PSEUDO_OPCODE *MatchGlobalPseudoOpcode(const char *name);
 void UnInitGlobalPseudoOpcodes();
 bool InitGlobalPseudoOpcodes();
@@ -18,62 +18,115 @@
 
 #include	"include.h"
 
-static SYM_TABLE
+static ASSEMBLY_STATE SYM_TABLE
 	*segmentSymbols;											// segment symbol list is kept here
 
+static unsigned int FindCodePageIndex(SEGMENT_RECORD *segment,unsigned int address)
+// Binary search the page index of segment, and return the number of pages
+// whose address is less than or equal to address
+{
+	unsigned int
+		low,
+		high,
+		middle;
+
+	low=0;
+	high=segment->numPages;
+	while(low<high)
+	{
+		middle=low+(high-low)/2;
+		if(segment->pageIndex[middle]->address<=address)
+		{
+			low=middle+1;
+		}
+		else
+		{
+			high=middle;
+		}
+	}
+	return(low);
+}
+
 static CODE_PAGE *FindCodePage(SEGMENT_RECORD *segment,unsigned int address)
 // find the code page of address, or the one immediately before it in the linked
 // list of code pages hanging off segment
 // NOTE: if the address is earlier than any code page within segment,
 // NULL will be returned
-// NOTE: this should probably be made faster
+// NOTE: code is usually generated sequentially, so the last page found is
+// checked before searching the index
 {
 	CODE_PAGE
-		*currentPage,
 		*bestPage;
+	unsigned int
+		index;
 
-	bestPage=NULL;
-	currentPage=segment->firstPage;
-
-	if(segment->pageCache&&segment->pageCache->address<=address)
-	{
-		currentPage=segment->firstPage;
-	}
-
-	while(currentPage&&currentPage->address<=address)
+	bestPage=segment->pageCache;
+	if(!bestPage||bestPage->address>address||(bestPage->next&&bestPage->next->address<=address))
 	{
-		bestPage=currentPage;
-		currentPage=currentPage->next;
+		bestPage=NULL;
+		if((index=FindCodePageIndex(segment,address)))
+		{
+			bestPage=segment->pageIndex[index-1];
+		}
 	}
 	segment->pageCache=bestPage;
 	return(bestPage);
 }
 
-static void DestroyCodePage(SEGMENT_RECORD *segment,CODE_PAGE *page)
-// unlink page from segment, and destroy it
+static void DestroyCodePages(SEGMENT_RECORD *segment)
+// destroy all the code pages of segment, and its page index
+// NOTE: the pages themselves came from the pass arena, so they are let go when it is reset
 {
-	if(page->next)
-	{
-		page->next->previous=page->previous;
-	}
-	if(page->previous)
-	{
-		page->previous->next=page->next;
-	}
-	else
+	segment->firstPage=NULL;
+	if(segment->pageIndex)
 	{
-		segment->firstPage=page->next;
+		DisposePtr(segment->pageIndex);
 	}
-	if(segment->pageCache==page)			// update the cache if needed
+	segment->pageCache=NULL;
+	segment->pageIndex=NULL;
+	segment->numPages=segment->maxPages=0;
+}
+
+static bool AddCodePageToIndex(SEGMENT_RECORD *segment,CODE_PAGE *page)
+// insert page into the page index of segment, keeping it sorted by address
+// NOTE: the index is grown as needed
+// NOTE: if this fails, it will return false
+{
+	CODE_PAGE
+		**newIndex;
+	unsigned int
+		newMaxPages;
+	unsigned int
+		index;
+
+	if(segment->numPages>=segment->maxPages)
 	{
-		segment->pageCache=page->previous;
+		newMaxPages=segment->maxPages?segment->maxPages*2:16;
+		if((newIndex=(CODE_PAGE **)NewPtr(newMaxPages*sizeof(CODE_PAGE *))))
+		{
+			if(segment->pageIndex)
+			{
+				memcpy(newIndex,segment->pageIndex,segment->numPages*sizeof(CODE_PAGE *));
+				DisposePtr(segment->pageIndex);
+			}
+			segment->pageIndex=newIndex;
+			segment->maxPages=newMaxPages;
+		}
+		else
+		{
+			return(false);
+		}
 	}
-	DisposePtr(page);
+	index=FindCodePageIndex(segment,page->address);
+	memmove(&segment->pageIndex[index+1],&segment->pageIndex[index],(segment->numPages-index)*sizeof(CODE_PAGE *));
+	segment->pageIndex[index]=page;
+	segment->numPages++;
+	return(true);
 }
 
-static CODE_PAGE *CreateCodePage(SEGMENT_RECORD *segment,CODE_PAGE *pageBefore)
-// create a new code page
-// link it to segment after pageBefore
+static CODE_PAGE *CreateCodePage(SEGMENT_RECORD *segment,CODE_PAGE *pageBefore,unsigned int address)
+// create a new code page for address
+// link it to segment after pageBefore, and add it to the segment's page index
 // NOTE: pageBefore can be passed in as NULL to link it to the start of the
 // segment
 // NOTE: the code page's usage map is initialized to be completely unused
@@ -84,57 +137,170 @@ static CODE_PAGE *CreateCodePage(SEGMENT_RECORD *segment,CODE_PAGE *pageBefore)
 	int
 		i;
 
-	if((page=(CODE_PAGE *)NewPtr(sizeof(CODE_PAGE))))
+	if((page=(CODE_PAGE *)ArenaNewPtr(passArena,sizeof(CODE_PAGE))))
 	{
+		page->address=address;
 		for(i=0;i<32;i++)
 		{
 			page->usageMap[i]=0;
 		}
-		if(pageBefore)
-		{
-			page->next=pageBefore->next;
-			page->previous=pageBefore;
-			pageBefore->next=page;
-		}
-		else
+		if(AddCodePageToIndex(segment,page))
 		{
-			if((page->next=segment->firstPage))
+			if(pageBefore)
 			{
-				page->next->previous=page;
+				if((page->next=pageBefore->next))
+				{
+					page->next->previous=page;
+				}
+				page->previous=pageBefore;
+				pageBefore->next=page;
 			}
-			page->previous=NULL;
-			segment->firstPage=page;
+			else
+			{
+				if((page->next=segment->firstPage))
+				{
+					page->next->previous=page;
+				}
+				page->previous=NULL;
+				segment->firstPage=page;
+			}
+			return(page);
 		}
-		return(page);
 	}
 	return(NULL);
 }
 
-bool AddBytesToSegment(SEGMENT_RECORD *segment,unsigned int address,unsigned char *bytes,unsigned int numBytes)
+static inline unsigned int UsageWord(CODE_PAGE *page,unsigned int index)
+// Return the 32 bits of the usage map of page which hold the bit for index
+// (bit 0 of the result is for the first byte of the 32)
+{
+	const unsigned char
+		*map;
+
+	map=&page->usageMap[(index>>3)&~3];
+	return(map[0]|(map[1]<<8)|(map[2]<<16)|((unsigned int)map[3]<<24));
+}
+
+static unsigned int LowestBit(unsigned int bits)
+// Return the number of the lowest set bit in bits (which must not be 0)
+{
+#if defined(__GNUC__)
+	return(__builtin_ctz(bits));
+#else
+	unsigned int
+		bit;
+
+	bit=0;
+	while(!(bits&0xFF))									// skip whole clear bytes first
+	{
+		bits>>=8;
+		bit+=8;
+	}
+	while(!(bits&1))
+	{
+		bits>>=1;
+		bit++;
+	}
+	return(bit);
+#endif
+}
+
+static unsigned int FindUsage(CODE_PAGE *page,unsigned int index,unsigned int endIndex,bool used)
+// Return the index of the first byte of page at or after index (and before endIndex)
+// whose usage matches used. If there is none, return endIndex.
+// NOTE: the usage map is searched 32 bits at a time
+{
+	unsigned int
+		bits;
+
+	while(index<endIndex)
+	{
+		bits=UsageWord(page,index);
+		if(!used)
+		{
+			bits=~bits;
+		}
+		bits&=0xFFFFFFFF<<(index&31);						// ignore bytes before index
+		if(bits)
+		{
+			return(Min((index&~31)+LowestBit(bits),endIndex));
+		}
+		index=(index&~31)+32;
+	}
+	return(endIndex);
+}
+
+static void SetUsage(CODE_PAGE *page,unsigned int index,unsigned int endIndex)
+// Mark bytes from index up to (but not including) endIndex of page as used
+{
+	while(index<endIndex&&(index&7))						// get to the start of a map byte
+	{
+		page->usageMap[index>>3]|=(1<<(index&7));
+		index++;
+	}
+	if(endIndex-index>=8)
+	{
+		memset(&page->usageMap[index>>3],0xFF,(endIndex-index)>>3);	// fill whole map bytes at once
+		index+=(endIndex-index)&~7;
+	}
+	while(index<endIndex)									// do what remains
+	{
+		page->usageMap[index>>3]|=(1<<(index&7));
+		index++;
+	}
+}
+
+static void ReportOverwrite(SEGMENT_RECORD *segment,unsigned int startAddress,unsigned int endAddress)
+// Complain that addresses from startAddress up to (but not including) endAddress
+// of segment were already occupied
+{
+	if(endAddress-startAddress==1)
+	{
+		AssemblyComplaint(NULL,false,"Overwriting address 0x%08X in segment '%s'\n",startAddress,STNodeName(segment->symbol));
+	}
+	else
+	{
+		AssemblyComplaint(NULL,false,"Overwriting addresses 0x%08X-0x%08X in segment '%s'\n",startAddress,endAddress-1,STNodeName(segment->symbol));
+	}
+}
+
+bool AddBytesToSegment(SEGMENT_RECORD *segment,unsigned int address,const unsigned char *bytes,unsigned int numBytes)
 // add bytes to segment at address
 // if there is a problem, report it, and return false
 // NOTE: this manages creating code pages, and linking them to segment
 // in the proper location.
+// NOTE: bytes are copied a page at a time, and each contiguous run of
+// addresses which was already occupied is reported once
 {
 	CODE_PAGE
 		*page;
 	unsigned int
 		baseAddress;
 	unsigned int
-		index;
+		index,
+		endIndex,
+		overlapIndex,
+		overlapEndIndex;
+	unsigned int
+		overlapStart,
+		overlapEnd;
+	bool
+		haveOverlap;
 	bool
 		fail;
 
 	fail=false;
+	haveOverlap=false;
+	overlapStart=overlapEnd=0;
 	while(numBytes&&!fail)
 	{
 		page=FindCodePage(segment,address);		// get the nearest page to the one we want to write into
 		baseAddress=address&~0xFF;						// mask off low part of address
 		if(!page||(page->address!=baseAddress))	// see if a new page needs to be created
 		{
-			if((page=CreateCodePage(segment,page)))
+			if((page=CreateCodePage(segment,page,baseAddress)))
 			{
-				page->address=baseAddress;			// set up the base address for this page
+				segment->pageCache=page;			// this is the page which will be used next
 			}
 			else
 			{
@@ -145,21 +311,40 @@ bool AddBytesToSegment(SEGMENT_RECORD *segment,unsigned int address,unsigned cha
 		if(!fail)										// make sure there's a good page to use
 		{
 			index=address&0xFF;
-			while(numBytes&&(index<0x100))				// copy bytes into the page
+			endIndex=Min(0x100,index+numBytes);		// work out how much of the page gets written
+
+			overlapIndex=index;
+			while((overlapIndex=FindUsage(page,overlapIndex,endIndex,true))<endIndex)	// look for runs which are already in use
 			{
-				if(page->usageMap[index>>3]&(1<<(index&7)))
+				overlapEndIndex=FindUsage(page,overlapIndex,endIndex,false);
+				if(haveOverlap&&overlapEnd==baseAddress+overlapIndex)
+				{
+					overlapEnd=baseAddress+overlapEndIndex;		// this continues the run from the last page
+				}
+				else
 				{
-					AssemblyComplaint(NULL,false,"Overwriting address 0x%08X in segment '%s'\n",address,STNodeName(segment->symbol));
+					if(haveOverlap)
+					{
+						ReportOverwrite(segment,overlapStart,overlapEnd);
+					}
+					haveOverlap=true;
+					overlapStart=baseAddress+overlapIndex;
+					overlapEnd=baseAddress+overlapEndIndex;
 				}
-				page->usageMap[index>>3]|=(1<<(index&7));	// update the usage map
-				page->pageData[index]=*bytes;		// drop the bytes into the page
-				bytes++;
-				index++;
-				address++;
-				numBytes--;
+				overlapIndex=overlapEndIndex;
 			}
+
+			SetUsage(page,index,endIndex);				// update the usage map
+			memcpy(&page->pageData[index],bytes,endIndex-index);	// drop the bytes into the page
+			bytes+=endIndex-index;
+			address+=endIndex-index;
+			numBytes-=endIndex-index;
 		}
 	}
+	if(haveOverlap)
+	{
+		ReportOverwrite(segment,overlapStart,overlapEnd);
+	}
 	return(!fail);
 }
 
@@ -205,11 +390,9 @@ SEGMENT_RECORD *MatchSegment(const char *segment)
 
 void DestroySegment(SEGMENT_RECORD *segment)
 // remove segment from existence
+// NOTE: the record is in the pass arena, so its memory goes when the arena is reset
 {
-	while(segment->firstPage)				// get rid of code page list
-	{
-		DestroyCodePage(segment,segment->firstPage);
-	}
+	DestroyCodePages(segment);				// get rid of code page list
 
 	STRemoveEntry(segmentSymbols,segment->symbol);
 
@@ -230,7 +413,6 @@ void DestroySegment(SEGMENT_RECORD *segment)
 	{
 		segmentsHead=segment->next;
 	}
-	DisposePtr(segment);
 }
 
 void DestroySegments()
@@ -249,11 +431,14 @@ SEGMENT_RECORD *CreateSegment(const char *segmentName,bool generateOutput)
 	SEGMENT_RECORD
 		*record;
 
-	if((record=(SEGMENT_RECORD *)NewPtr(sizeof(SEGMENT_RECORD))))
+	if((record=(SEGMENT_RECORD *)ArenaNewPtr(passArena,sizeof(SEGMENT_RECORD))))
 	{
 		record->generateOutput=generateOutput;
 		record->pageCache=NULL;
 		record->firstPage=NULL;
+		record->pageIndex=NULL;
+		record->numPages=0;
+		record->maxPages=0;
 		record->currentPC=0;
 		record->codeGenOffset=0;
 
@@ -275,7 +460,6 @@ SEGMENT_RECORD *CreateSegment(const char *segmentName,bool generateOutput)
 			record->next=NULL;		// no next for this one
 			return(record);
 		}
-		DisposePtr(record);
 	}
 	return(NULL);
 }
@@ -300,10 +484,7 @@ static void GetSegmentMinMax(SEGMENT_RECORD *segment,unsigned int *minAddress,un
 		}
 		*minAddress=page->address+i;
 
-		while(page->next)
-		{
-			page=page->next;
-		}
+		page=segment->pageIndex[segment->numPages-1];	// last page of the segment
 
 		i=255;
 		while(i>0&&(page->usageMap[i>>3]&(1<<(i&7)))==0)
@@ -356,6 +537,67 @@ void DumpSegmentsListing(FILE *file)
 	}
 }
 
+void DumpSegmentRecords(FILE *file,SEGMENT_RECORD *segment,unsigned int maxRecordLength,SEGMENT_DUMP_RECORD *dumpRecord)
+// Hand the used bytes of segment to dumpRecord, as records of at most maxRecordLength bytes
+// Records hold only consecutive used bytes. They are also split where the address is
+// a multiple of maxRecordLength, and at each 64K boundary.
+// Runs which continue from one page into the next are joined.
+{
+	CODE_PAGE
+		*page;
+	unsigned char
+		record[256];
+	unsigned int
+		recordAddress,
+		recordLength,
+		address,
+		index,
+		runEnd,
+		count;
+
+	maxRecordLength=Max(Min(maxRecordLength,sizeof(record)),1);
+	recordAddress=recordLength=0;
+	page=segment->firstPage;
+	while(page)
+	{
+		index=0;
+		while((index=FindUsage(page,index,256,true))<256)
+		{
+			runEnd=FindUsage(page,index,256,false);
+			address=page->address+index;
+			if(recordLength&&recordAddress+recordLength!=address)	// does not continue the record, so flush it
+			{
+				dumpRecord(file,recordAddress,record,recordLength);
+				recordLength=0;
+			}
+			while(index<runEnd)
+			{
+				if(!recordLength)
+				{
+					recordAddress=address;
+				}
+				count=Min(runEnd-index,maxRecordLength-recordLength);
+				count=Min(count,maxRecordLength-address%maxRecordLength);		// stop at the next multiple of the record length
+				count=Min(count,0x10000-(address&0xFFFF));						// and at the next 64K boundary
+				memcpy(&record[recordLength],&page->pageData[index],count);
+				recordLength+=count;
+				index+=count;
+				address+=count;
+				if(recordLength==maxRecordLength||!(address%maxRecordLength)||!(address&0xFFFF))
+				{
+					dumpRecord(file,recordAddress,record,recordLength);
+					recordLength=0;
+				}
+			}
+		}
+		page=page->next;
+	}
+	if(recordLength)
+	{
+		dumpRecord(file,recordAddress,record,recordLength);
+	}
+}
+
 void UnInitSegments()
 // undo what InitSegments did
 {
@@ -365,7 +607,7 @@ void UnInitSegments()
 bool InitSegments()
 // initialize symbol table for segments
 {
-	if((segmentSymbols=STNewSymbolTable(100)))
+	if((segmentSymbols=STNewArenaSymbolTable(100,passArena)))
 	{
 		return(true);
 	}
@@ -14,12 +14,13 @@
 //	along with tpasm; see the file "LICENSE.TXT".
 
 
-bool AddBytesToSegment(SEGMENT_RECORD *segment,unsigned int address,unsigned char *bytes,unsigned int numBytes);
+bool AddBytesToSegment(SEGMENT_RECORD *segment,unsigned int address,const unsigned char *bytes,unsigned int numBytes);
 bool AddSpaceToSegment(SEGMENT_RECORD *segment,unsigned int address,unsigned int numBytes);
 SEGMENT_RECORD *MatchSegment(const char *segment);
 void DestroySegment(SEGMENT_RECORD *segment);
 void DestroySegments();
 SEGMENT_RECORD *CreateSegment(const char *segmentName,bool generateOutput);
 void DumpSegmentsListing(FILE *file);
+void DumpSegmentRecords(FILE *file,SEGMENT_RECORD *segment,unsigned int maxRecordLength,SEGMENT_DUMP_RECORD *dumpRecord);
 void UnInitSegments();
 bool InitSegments();
@@ -0,0 +1,611 @@
+//	Copyright (C) 1999-2012 Core Technologies.
+//
+//	This file is part of tpasm.
+//
+//	tpasm is free software; you can redistribute it and/or modify
+//	it under the terms of the tpasm LICENSE AGREEMENT.
+//
+//	tpasm is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	tpasm LICENSE AGREEMENT for more details.
+//
+//	You should have received a copy of the tpasm LICENSE AGREEMENT
+//	along with tpasm; see the file "LICENSE.TXT".
+
+
+// Resident assembly server, and the client which hands assemblies to it.
+// The server listens on a Unix domain socket. Each connection carries one assembly:
+// the length of the request, then the client's current directory and its command line
+// options, each 0 terminated. The assembly is run on its own thread, with the messages
+// it reports written back over the connection, followed by a 0 and a status
+// character ('0' if the assembly succeeded, '1' if not).
+// The server keeps the tables it built at startup, along with a cache of source file
+// text shared by all of its assemblies. Cached text is used for as long as the file's
+// size, modification time and inode stay the same.
+// NOTE: the cache belongs to the server, not to any one assembly, so it is allocated
+// with malloc rather than NewPtr.
+// Where there are no Unix domain sockets (or no threads), there is no server, and
+// every assembly is run by the process which was given it.
+
+#include	"include.h"
+
+#ifndef NO_SERVER
+
+#include	<pthread.h>
+#include	<unistd.h>
+#include	<signal.h>
+#include	<stddef.h>
+#include	<stdint.h>
+#include	<sys/stat.h>
+#include	<sys/socket.h>
+#include	<sys/un.h>
+
+#define		MAX_REQUEST_LENGTH		(1024*1024)		// largest request the server will accept
+#define		SOURCE_CACHE_HASH_SIZE	1024			// number of chains in the source cache hash table (must be a power of 2)
+
+struct CACHED_SOURCE
+{
+	CACHED_SOURCE
+		*next;								// next source in this hash chain
+	unsigned int
+		refCount;							// number of assemblies using the text, plus one while it is in the cache
+	dev_t
+		device;								// what the file looked like when it was read
+	ino_t
+		inode;
+	off_t
+		size;
+	time_t
+		modifyTime;
+	unsigned int
+		textLength;
+	char
+		data[1];							// text of the file, followed by its path (0 terminated)
+};
+
+static pthread_mutex_t
+	sourceCacheMutex=PTHREAD_MUTEX_INITIALIZER;	// protects everything in the source cache
+static CACHED_SOURCE
+	*sourceCache[SOURCE_CACHE_HASH_SIZE];
+
+static unsigned int HashSourcePath(const char *path)
+// return the source cache hash chain which holds path
+{
+	unsigned int
+		hash;
+
+	hash=2166136261U;
+	while(*path)
+	{
+		hash=(hash^(unsigned char)*path++)*16777619U;
+	}
+	return(hash&(SOURCE_CACHE_HASH_SIZE-1));
+}
+
+static const char *CachedSourcePath(CACHED_SOURCE *source)
+// return the path of a cached source
+{
+	return(&source->data[source->textLength]);
+}
+
+static bool CachedSourceMatches(CACHED_SOURCE *source,struct stat *info)
+// See if source was read from the file described by info, and the file has not changed since
+{
+	return(source->device==info->st_dev&&source->inode==info->st_ino&&source->size==info->st_size&&source->modifyTime==info->st_mtime);
+}
+
+static void ReleaseCachedSourceRecord(CACHED_SOURCE *source)
+// Drop a reference to source, getting rid of it if it was the last one
+// NOTE: the source cache must be locked when this is called
+{
+	if(!(--source->refCount))
+	{
+		free(source);
+	}
+}
+
+static CACHED_SOURCE **FindCachedSource(const char *path)
+// Return a pointer to the link which points to the cached source for path
+// (which points to NULL if there is none)
+// NOTE: the source cache must be locked when this is called
+{
+	CACHED_SOURCE
+		**link;
+
+	link=&sourceCache[HashSourcePath(path)];
+	while(*link&&strcmp(CachedSourcePath(*link),path))
+	{
+		link=&(*link)->next;
+	}
+	return(link);
+}
+
+static CACHED_SOURCE *ReadCachedSource(const char *path)
+// Read the file at path into a new cached source record
+// If it can not be read, return NULL
+{
+	FILE
+		*file;
+	struct stat
+		info;
+	CACHED_SOURCE
+		*source;
+	unsigned int
+		pathLength;
+
+	source=NULL;
+	if((file=fopen(path,"rb")))
+	{
+		if(fstat(fileno(file),&info)==0&&S_ISREG(info.st_mode)&&info.st_size<(off_t)0x7FFFFFFF)
+		{
+			pathLength=strlen(path);
+			if((source=(CACHED_SOURCE *)malloc(sizeof(CACHED_SOURCE)+info.st_size+pathLength)))
+			{
+				source->next=NULL;
+				source->refCount=1;
+				source->device=info.st_dev;
+				source->inode=info.st_ino;
+				source->size=info.st_size;
+				source->modifyTime=info.st_mtime;
+				source->textLength=(unsigned int)info.st_size;
+				strcpy(&source->data[source->textLength],path);
+				if(fread(&source->data[0],1,source->textLength,file)!=source->textLength)
+				{
+					free(source);						// file changed while reading it, so leave it alone
+					source=NULL;
+				}
+			}
+		}
+		fclose(file);
+	}
+	return(source);
+}
+
+static bool ProvideCachedSource(void *providerData,const char *name,const char **text,unsigned int *textLength)
+// Source provider used by server assemblies: hand back the cached text of name, reading it
+// into the cache if it is not there yet, or has changed since it was read
+// If name can not be read, return false, so the assembler will look for it itself
+{
+	char
+		path[MAX_FILE_PATH];
+	struct stat
+		info;
+	CACHED_SOURCE
+		**link,
+		*source;
+
+	if(CreateFilePath(name,path)&&stat(path,&info)==0)
+	{
+		pthread_mutex_lock(&sourceCacheMutex);
+		source=*FindCachedSource(path);
+		if(source&&CachedSourceMatches(source,&info))
+		{
+			source->refCount++;
+		}
+		else
+		{
+			source=NULL;
+		}
+		pthread_mutex_unlock(&sourceCacheMutex);
+
+		if(!source&&(source=ReadCachedSource(path)))
+		{
+			pthread_mutex_lock(&sourceCacheMutex);
+			link=FindCachedSource(path);
+			if(*link)									// replace what was there
+			{
+				source->next=(*link)->next;
+				ReleaseCachedSourceRecord(*link);
+			}
+			*link=source;
+			source->refCount++;							// one for the cache, and one for the caller
+			pthread_mutex_unlock(&sourceCacheMutex);
+		}
+		if(source)
+		{
+			*text=&source->data[0];
+			*textLength=source->textLength;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+static void ReleaseCachedSource(void *providerData,const char *text)
+// The assembler is done with text handed over by ProvideCachedSource
+{
+	pthread_mutex_lock(&sourceCacheMutex);
+	ReleaseCachedSourceRecord((CACHED_SOURCE *)(text-offsetof(CACHED_SOURCE,data)));
+	pthread_mutex_unlock(&sourceCacheMutex);
+}
+
+static void DestroySourceCache()
+// get rid of everything in the source cache
+{
+	unsigned int
+		i;
+	CACHED_SOURCE
+		*source;
+
+	pthread_mutex_lock(&sourceCacheMutex);
+	for(i=0;i<SOURCE_CACHE_HASH_SIZE;i++)
+	{
+		while((source=sourceCache[i]))
+		{
+			sourceCache[i]=source->next;
+			ReleaseCachedSourceRecord(source);
+		}
+	}
+	pthread_mutex_unlock(&sourceCacheMutex);
+}
+
+static bool WriteAll(int connection,const void *data,size_t length)
+// write all of data to connection
+// return false if it could not be written
+{
+	ssize_t
+		numWritten;
+
+	while(length)
+	{
+		if((numWritten=write(connection,data,length))<0)
+		{
+			if(errno!=EINTR)
+			{
+				return(false);
+			}
+		}
+		else
+		{
+			data=(const char *)data+numWritten;
+			length-=numWritten;
+		}
+	}
+	return(true);
+}
+
+static bool ReadAll(int connection,void *data,size_t length)
+// read exactly length bytes from connection into data
+// return false if they could not be read
+{
+	ssize_t
+		numRead;
+
+	while(length)
+	{
+		if((numRead=read(connection,data,length))<=0)
+		{
+			if(numRead==0||errno!=EINTR)
+			{
+				return(false);
+			}
+		}
+		else
+		{
+			data=(char *)data+numRead;
+			length-=numRead;
+		}
+	}
+	return(true);
+}
+
+static char *ReadRequest(int connection,unsigned int *argc,char ***argv)
+// Read an assembly request from connection, and break it into the client's directory (which
+// is returned), and an argument list (argv[0] is the program name, and the list is NULL terminated)
+// The request and argument list are in one allocation, which the caller must free
+// If there is a problem, return NULL
+{
+	unsigned int
+		length,
+		numStrings,
+		i;
+	char
+		*request,
+		*string;
+
+	if(ReadAll(connection,&length,sizeof(length))&&length&&length<=MAX_REQUEST_LENGTH)
+	{
+		if((request=(char *)malloc(length+(length+3)*sizeof(char *))))
+		{
+			if(ReadAll(connection,request,length)&&request[length-1]=='\0')
+			{
+				*argv=(char **)&request[(length+sizeof(char *)-1)&~(sizeof(char *)-1)];	// argument list goes after the request text
+				numStrings=0;
+				for(i=0;i<length;i++)
+				{
+					if(!request[i])
+					{
+						numStrings++;
+					}
+				}
+				(*argv)[0]=(char *)programName;
+				*argc=1;
+				string=request+strlen(request)+1;		// skip over the directory
+				for(i=1;i<numStrings;i++)
+				{
+					(*argv)[(*argc)++]=string;
+					string+=strlen(string)+1;
+				}
+				(*argv)[*argc]=NULL;
+				return(request);
+			}
+			free(request);
+		}
+	}
+	return(NULL);
+}
+
+static void *ServeConnection(void *connectionPointer)
+// Run the assembly requested over a connection to the server, sending back the
+// messages it reports, and its status
+// NOTE: this runs on its own thread, so each assembly it runs has its own state
+{
+	int
+		connection;
+	char
+		*directory;
+	unsigned int
+		argc,
+		i;
+	char
+		**argv;
+	FILE
+		*file;
+	bool
+		succeeded;
+
+	connection=(int)(intptr_t)connectionPointer;
+	if((directory=ReadRequest(connection,&argc,&argv)))
+	{
+		if((file=fdopen(dup(connection),"w")))
+		{
+			SetWorkingDirectory(directory);
+			SetMessageFile(file);
+			SetSourceProvider(ProvideCachedSource,ReleaseCachedSource,NULL);
+
+			succeeded=true;
+			for(i=1;i<argc;i++)
+			{
+				if(!strcmp(argv[i],"--serve"))
+				{
+					ReportComplaint(true,"--serve can not be sent to a server\n");
+					succeeded=false;
+				}
+			}
+			if(succeeded)
+			{
+				succeeded=RunAssembly(argc,argv);
+			}
+
+			SetSourceProvider(NULL,NULL,NULL);
+			SetMessageFile(NULL);
+			SetWorkingDirectory(NULL);
+
+			fputc('\0',file);
+			fputc(succeeded?'0':'1',file);
+			fclose(file);
+		}
+		free(directory);
+	}
+	close(connection);
+	return(NULL);
+}
+
+static bool CreateSocketAddress(const char *socketName,struct sockaddr_un *address)
+// Fill in address for the socket called socketName
+// If the name is too long, complain and return false
+{
+	if(strlen(socketName)<sizeof(address->sun_path))
+	{
+		memset(address,0,sizeof(struct sockaddr_un));
+		address->sun_family=AF_UNIX;
+		strcpy(address->sun_path,socketName);
+		return(true);
+	}
+	ReportComplaint(true,"Socket name '%s' is too long\n",socketName);
+	return(false);
+}
+
+bool RunClient(const char *socketName,unsigned int argc,char *argv[],bool *connected)
+// Send the assembly described by argv (which does not include the program name) to the
+// server listening on socketName, and report what it sends back.
+// If the server could not be reached, connected is returned false, and nothing is reported
+// Return false if the assembly failed, or the server could not be talked to
+{
+	struct sockaddr_un
+		address;
+	int
+		connection;
+	char
+		directory[MAX_FILE_PATH];
+	unsigned int
+		length,
+		i;
+	char
+		*request,
+		*requestEnd;
+	char
+		buffer[MAX_STRING];
+	ssize_t
+		numRead,
+		messageLength;
+	char
+		*end;
+	bool
+		haveStatus,
+		sawEnd,
+		lost;
+	char
+		status;
+
+	*connected=false;
+	if(CreateSocketAddress(socketName,&address)&&getcwd(directory,MAX_FILE_PATH))
+	{
+		if((connection=socket(AF_UNIX,SOCK_STREAM,0))>=0)
+		{
+			if(connect(connection,(struct sockaddr *)&address,sizeof(address))==0)
+			{
+				*connected=true;
+				status='1';
+				length=strlen(directory)+1;
+				for(i=0;i<argc;i++)
+				{
+					length+=strlen(argv[i])+1;
+				}
+				if((request=(char *)NewPtr(length)))
+				{
+					strcpy(request,directory);
+					requestEnd=request+strlen(directory)+1;
+					for(i=0;i<argc;i++)
+					{
+						strcpy(requestEnd,argv[i]);
+						requestEnd+=strlen(argv[i])+1;
+					}
+					if(WriteAll(connection,&length,sizeof(length))&&WriteAll(connection,request,length))
+					{
+						haveStatus=sawEnd=lost=false;
+						while(!haveStatus&&!lost)
+						{
+							if((numRead=read(connection,buffer,sizeof(buffer)))>0)
+							{
+								if(sawEnd)
+								{
+									status=buffer[0];
+									haveStatus=true;
+								}
+								else
+								{
+									end=(char *)memchr(buffer,'\0',numRead);
+									messageLength=end?end-buffer:numRead;
+									fwrite(buffer,1,messageLength,stderr);	// pass messages on as they arrive
+									if(end)
+									{
+										sawEnd=true;
+										if(messageLength+1<numRead)
+										{
+											status=buffer[messageLength+1];
+											haveStatus=true;
+										}
+									}
+								}
+							}
+							else if(numRead==0||errno!=EINTR)
+							{
+								lost=true;
+							}
+						}
+						if(!haveStatus)
+						{
+							ReportComplaint(true,"Lost connection to server on '%s'\n",socketName);
+						}
+					}
+					else
+					{
+						ReportComplaint(true,"Failed to send assembly to server on '%s': %s\n",socketName,strerror(errno));
+					}
+					DisposePtr(request);
+				}
+				else
+				{
+					ReportComplaint(true,"Failed to allocate server request\n");
+				}
+				close(connection);
+				return(status=='0');
+			}
+			close(connection);
+		}
+	}
+	return(false);
+}
+
+bool RunServer(const char *socketName)
+// Listen on socketName, running each assembly sent there on its own thread
+// This only returns if the server can not be started, or stops accepting connections,
+// in which case it complains, and returns false
+{
+	struct sockaddr_un
+		address;
+	struct stat
+		info;
+	int
+		listener,
+		connection;
+	pthread_attr_t
+		threadAttributes;
+	pthread_t
+		thread;
+	bool
+		fail;
+
+	fail=false;
+	if(CreateSocketAddress(socketName,&address))
+	{
+		signal(SIGPIPE,SIG_IGN);						// clients which go away should not take the server with them
+		if(stat(socketName,&info)==0&&S_ISSOCK(info.st_mode))
+		{
+			unlink(socketName);							// left over from an old server
+		}
+		if((listener=socket(AF_UNIX,SOCK_STREAM,0))>=0)
+		{
+			if(bind(listener,(struct sockaddr *)&address,sizeof(address))==0&&listen(listener,SOMAXCONN)==0)
+			{
+				pthread_attr_init(&threadAttributes);
+				pthread_attr_setdetachstate(&threadAttributes,PTHREAD_CREATE_DETACHED);
+				while(!fail)
+				{
+					if((connection=accept(listener,NULL,NULL))>=0)
+					{
+						if(pthread_create(&thread,&threadAttributes,ServeConnection,(void *)(intptr_t)connection))
+						{
+							ReportComplaint(true,"Failed to start thread for server connection\n");
+							close(connection);
+						}
+					}
+					else if(errno!=EINTR&&errno!=ECONNABORTED)
+					{
+						ReportComplaint(true,"Server on '%s' failed to accept connection: %s\n",socketName,strerror(errno));
+						fail=true;
+					}
+				}
+				pthread_attr_destroy(&threadAttributes);
+				unlink(socketName);
+			}
+			else
+			{
+				ReportComplaint(true,"Could not listen on '%s': %s\n",socketName,strerror(errno));
+				fail=true;
+			}
+			close(listener);
+		}
+		else
+		{
+			ReportComplaint(true,"Could not create server socket: %s\n",strerror(errno));
+			fail=true;
+		}
+		DestroySourceCache();
+	}
+	else
+	{
+		fail=true;
+	}
+	return(!fail);
+}
+
+#else
+
+bool RunClient(const char *socketName,unsigned int argc,char *argv[],bool *connected)
+// There is no server to hand the assembly to, so leave connected false, and let it be run here
+{
+	*connected=false;
+	return(true);
+}
+
+bool RunServer(const char *socketName)
+// There is no server on this system
+{
+	ReportComplaint(true,"--serve is not supported on this system\n");
+	return(false);
+}
+
+#endif
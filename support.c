@@ -19,6 +19,8 @@
 
 #include	"include.h"
 
+#define		INCBIN_BUFFER_SIZE		65536		// amount of an incbin file read and added to the segment at a time
+
 void ReportDisallowedLabel(const PARSED_LABEL *lineLabel)
 // complain that a label is not allowed on this op
 {
@@ -196,28 +198,22 @@ bool Check16RelativeRange(int value,bool generateMessage,bool isError)
 	return(false);
 }
 
-bool GenerateByte(unsigned char value,LISTING_RECORD *listingRecord)
-// output the value to the current segment
+bool GenerateBytes(const unsigned char *values,unsigned int numBytes,LISTING_RECORD *listingRecord)
+// output numBytes values to the current segment in one run
 // This will return false only if a "hard" error occurs
 {
 	bool
 		fail;
-	unsigned int
-		length;
 
 	fail=false;
 	if(currentSegment)
 	{
 		if(!intermediatePass)				// only do the real work if necessary
 		{
-			length=strlen(listingRecord->listObjectString);
-			if(length+4<MAX_STRING)
-			{
-				sprintf(&listingRecord->listObjectString[length],"%02X ",value);		// create list file output
-			}
-			fail=!AddBytesToSegment(currentSegment,currentSegment->currentPC,&value,1);
+			AddListObjectBytes(listingRecord,values,numBytes);		// create list file output
+			fail=!AddBytesToSegment(currentSegment,currentSegment->currentPC,values,numBytes);
 		}
-		currentSegment->currentPC++;
+		currentSegment->currentPC+=numBytes;
 	}
 	else
 	{
@@ -226,25 +222,31 @@ bool GenerateByte(unsigned char value,LISTING_RECORD *listingRecord)
 	return(!fail);
 }
 
+bool GenerateByte(unsigned char value,LISTING_RECORD *listingRecord)
+// output the value to the current segment
+// This will return false only if a "hard" error occurs
+{
+	return(GenerateBytes(&value,1,listingRecord));
+}
+
 bool GenerateWord(unsigned int value,LISTING_RECORD *listingRecord,bool bigEndian)
 // output the value to the current segment as a word in the given endian.
 // This will return false only if a "hard" error occurs
 {
+	unsigned char
+		outputBytes[2];
+
 	if(bigEndian)
 	{
-		if(GenerateByte(value>>8,listingRecord))
-		{
-			return(GenerateByte(value&0xFF,listingRecord));
-		}
+		outputBytes[0]=value>>8;
+		outputBytes[1]=value&0xFF;
 	}
 	else
 	{
-		if(GenerateByte(value&0xFF,listingRecord))
-		{
-			return(GenerateByte(value>>8,listingRecord));
-		}
+		outputBytes[0]=value&0xFF;
+		outputBytes[1]=value>>8;
 	}
-	return(false);
+	return(GenerateBytes(outputBytes,2,listingRecord));
 }
 
 bool HandleDB(const char *opcodeName,const char *line,unsigned int *lineIndex,const PARSED_LABEL *lineLabel,LISTING_RECORD *listingRecord)
@@ -261,8 +263,6 @@ bool HandleDB(const char *opcodeName,const char *line,unsigned int *lineIndex,co
 	bool
 		done,
 		fail;
-	unsigned int
-		i;
 
 	done=false;
 	fail=!ProcessLineLocationLabel(lineLabel);		// deal with any label on the line
@@ -270,11 +270,9 @@ bool HandleDB(const char *opcodeName,const char *line,unsigned int *lineIndex,co
 	{
 		if(ParseQuotedString(line,lineIndex,'"','"',outputString,&stringLength))
 		{
-			i=0;
-			while(!fail&&i<stringLength)
+			if(stringLength)
 			{
-				fail=!GenerateByte(outputString[i],listingRecord);
-				i++;
+				fail=!GenerateBytes((unsigned char *)outputString,stringLength,listingRecord);
 			}
 		}
 		else if(ParseExpression(line,lineIndex,&value,&unresolved))
@@ -488,7 +486,7 @@ bool HandleIncbin(const char *opcodeName,const char *line,unsigned int *lineInde
 	FILE
 		*file;
 	unsigned char
-		inputDataBuffer[1024];
+		*inputDataBuffer;
 	int
 		bytesRead;
 
@@ -501,9 +499,13 @@ bool HandleIncbin(const char *opcodeName,const char *line,unsigned int *lineInde
 			{
 				if(currentSegment)
 				{
-					if((file=fopen(fileName,"rb")))
+					if((file=OpenFile(fileName,"rb")))
 					{
-						if(intermediatePass)							// only do the real work if necessary
+						if(!NoteInputFile(fileName))					// remember it was read, along with the source files
+						{
+							fail=true;
+						}
+						else if(intermediatePass)						// only do the real work if necessary
 						{
 							if(fseek(file,0,SEEK_END)==0)
 							{
@@ -517,24 +519,33 @@ bool HandleIncbin(const char *opcodeName,const char *line,unsigned int *lineInde
 						}
 						else
 						{
-							done=false;
-							while(!fail&&!done)
+							if((inputDataBuffer=(unsigned char *)NewPtr(INCBIN_BUFFER_SIZE)))
 							{
-								bytesRead=fread(inputDataBuffer,1,1024,file);
-								if(bytesRead>0)
+								done=false;
+								while(!fail&&!done)
 								{
-									fail=!AddBytesToSegment(currentSegment,currentSegment->currentPC,inputDataBuffer,bytesRead);
-									currentSegment->currentPC+=bytesRead;
-								}
-								else if(bytesRead==0)
-								{
-									done=true;
-								}
-								else
-								{
-									AssemblyComplaint(NULL,true,"Failed reading file '%s'. %s\n",fileName,strerror(errno));
-									fail=true;
+									bytesRead=fread(inputDataBuffer,1,INCBIN_BUFFER_SIZE,file);
+									if(bytesRead>0)
+									{
+										fail=!AddBytesToSegment(currentSegment,currentSegment->currentPC,inputDataBuffer,bytesRead);
+										currentSegment->currentPC+=bytesRead;
+									}
+									else if(bytesRead==0)
+									{
+										done=true;
+									}
+									else
+									{
+										AssemblyComplaint(NULL,true,"Failed reading file '%s'. %s\n",fileName,strerror(errno));
+										fail=true;
+									}
 								}
+								DisposePtr(inputDataBuffer);
+							}
+							else
+							{
+								ReportComplaint(true,"Could not allocate memory for incbin buffer\nOS Reports: %s\n",strerror(errno));
+								fail=true;
 							}
 						}
 						fclose(file);
@@ -27,6 +27,7 @@ bool Check16BitIndexRange(int value,bool generateMessage,bool isError);
 bool Check32BitIndexRange(int value,bool generateMessage,bool isError);
 bool Check8RelativeRange(int value,bool generateMessage,bool isError);
 bool Check16RelativeRange(int value,bool generateMessage,bool isError);
+bool GenerateBytes(const unsigned char *values,unsigned int numBytes,LISTING_RECORD *listingRecord);
 bool GenerateByte(unsigned char value,LISTING_RECORD *listingRecord);
 bool GenerateWord(unsigned int value,LISTING_RECORD *listingRecord,bool bigEndian);
 bool HandleDB(const char *opcodeName,const char *line,unsigned int *lineIndex,const PARSED_LABEL *lineLabel,LISTING_RECORD *listingRecord);
@@ -18,7 +18,8 @@
 
 #include	"include.h"
 
-#define 	ST_MAX_HASH_TABLE_BITS		10		// maximum number of bits that will be used for a hash table lookup
+#define 	ST_DEFAULT_HASH_TABLE_BITS	10		// number of bits used for a hash table lookup when the table could be arbitrarily large
+#define 	ST_MAX_HASH_TABLE_BITS		24		// maximum number of bits that a hash table will ever grow to use
 
 struct SYM_TABLE_NODE
 {
@@ -40,30 +41,36 @@ struct SYM_TABLE
 	SYM_TABLE_NODE
 		*first,									// linearly linked table
 		*last;
+	unsigned int
+		numEntries;								// number of nodes currently in the table
 	unsigned int
 		hashTableBits;							// tells how many bits of the hash value are used to index the hash list (also implies the size of the hash list)
 	SYM_TABLE_NODE
-		*hashList[1];							// variable length hash table
+		**hashList;								// hash table (grows as entries are added)
+	MEMORY_ARENA
+		*arena;									// if not NULL, nodes are allocated from this, and are not disposed individually
 };
 
 static unsigned int STHash(const char *name)
-// Return the full hash value for the given name.
+// Return the full hash value for the given name (FNV-1a).
+// The hash is made case-insensitive so the same value can be used to search either way.
 {
 	unsigned int
 		hash;
-	unsigned int
-		count;
 	unsigned char
 		c;
 
-	hash=0;
-	for(count=0;(c=name[count]);count++)
+	hash=2166136261U;
+	while((c=*(name++)))
 	{
-		c=tolower(c);						// make hash case-insensitive so we can search either way
-		hash^=1<<(c&0x0F);
-		hash^=((c>>4)&0x0F)<<(count&0x07);
+		if(c>='A'&&c<='Z')
+		{
+			c+='a'-'A';
+		}
+		hash^=c;
+		hash*=16777619U;
 	}
-	return(hash);
+	return(hash^(hash>>16));				// fold the well mixed high bits down into the ones used to index the table
 }
 
 static inline bool STCompNames(const char *name1,const char *name2)
@@ -83,14 +90,13 @@ SYM_TABLE_NODE *STFindNode(SYM_TABLE *table,const char *name)
 // return NULL if none could be located
 {
 	unsigned int
-		hashIndex;
+		hashValue;
 	SYM_TABLE_NODE
 		*node;
 
-	hashIndex=STHash(name)&((1<<table->hashTableBits)-1);
-	
-	node=table->hashList[hashIndex];
-	while(node&&!STCompNames(name,node->name))
+	hashValue=STHash(name);
+	node=table->hashList[hashValue&((1<<table->hashTableBits)-1)];
+	while(node&&(node->hashValue!=hashValue||!STCompNames(name,node->name)))
 	{
 		node=node->hashNext;
 	}
@@ -102,14 +108,13 @@ SYM_TABLE_NODE *STFindNodeNoCase(SYM_TABLE *table,const char *name)
 // return NULL if none could be located
 {
 	unsigned int
-		hashIndex;
+		hashValue;
 	SYM_TABLE_NODE
 		*node;
 
-	hashIndex=STHash(name)&((1<<table->hashTableBits)-1);
-	
-	node=table->hashList[hashIndex];
-	while(node&&!STCompNamesNoCase(name,node->name))
+	hashValue=STHash(name);
+	node=table->hashList[hashValue&((1<<table->hashTableBits)-1)];
+	while(node&&(node->hashValue!=hashValue||!STCompNamesNoCase(name,node->name)))
 	{
 		node=node->hashNext;
 	}
@@ -158,18 +163,99 @@ void STRemoveEntry(SYM_TABLE *table,SYM_TABLE_NODE *node)
 		}
 	}
 
-	DisposePtr(node);							// and then destroy it
+	table->numEntries--;
+	if(!table->arena)
+	{
+		DisposePtr(node);						// and then destroy it
+	}
+}
+
+static void STGrowHashTable(SYM_TABLE *table)
+// If the table has gotten crowded, double the size of its hash list, and
+// redistribute the nodes.
+// NOTE: nodes which share a hash chain are kept in the same relative order
+// so that searches for duplicate names keep returning the same node.
+// NOTE: if there is no memory to grow, the table just stays as it is.
+{
+	SYM_TABLE_NODE
+		**newHashList,
+		*node,
+		*prevNode;
+	unsigned int
+		oldSize,
+		newSize,
+		count,
+		hashIndex;
+
+	oldSize=1<<table->hashTableBits;
+	if((table->numEntries>oldSize*2)&&(table->hashTableBits<ST_MAX_HASH_TABLE_BITS))	// shoot for two entries per hash bucket
+	{
+		newSize=oldSize*2;
+		if((newHashList=(SYM_TABLE_NODE **)NewPtr(newSize*sizeof(SYM_TABLE_NODE *))))
+		{
+			for(count=0;count<newSize;count++)
+			{
+				newHashList[count]=NULL;
+			}
+			for(count=0;count<oldSize;count++)
+			{
+				node=table->hashList[count];			// find the end of this chain
+				while(node&&node->hashNext)
+				{
+					node=node->hashNext;
+				}
+				while(node)								// walk it backwards, pushing each node onto the front of its new chain
+				{
+					prevNode=node->hashPrev;
+					hashIndex=node->hashValue&(newSize-1);
+					if(newHashList[hashIndex])
+					{
+						newHashList[hashIndex]->hashPrev=node;
+					}
+					node->hashNext=newHashList[hashIndex];
+					node->hashPrev=NULL;
+					newHashList[hashIndex]=node;
+					node=prevNode;
+				}
+			}
+			DisposePtr(table->hashList);
+			table->hashList=newHashList;
+			table->hashTableBits++;
+		}
+	}
+}
+
+static void STLinkHashNode(SYM_TABLE *table,SYM_TABLE_NODE *newNode)
+// Link a newly created node to the start of its hash chain, and count it
+{
+	unsigned int
+		hashIndex;
+
+	table->numEntries++;
+	STGrowHashTable(table);
+
+	hashIndex=newNode->hashValue&((1<<table->hashTableBits)-1);
+	if(table->hashList[hashIndex])
+	{
+		table->hashList[hashIndex]->hashPrev=newNode;
+	}
+	newNode->hashNext=table->hashList[hashIndex];
+	newNode->hashPrev=NULL;
+	table->hashList[hashIndex]=newNode;
 }
 
-static SYM_TABLE_NODE *STCreateNode(const char *name,void *data)
+static SYM_TABLE_NODE *STCreateNode(SYM_TABLE *table,const char *name,void *data)
 // Returns a new node containing the given name and data.
 // NOTE: the hash value is calculated at this time, and placed into
 // the node as well
 {
 	SYM_TABLE_NODE
 		*newNode;
+	unsigned int
+		size;
 
-	if((newNode=(SYM_TABLE_NODE*)NewPtr(sizeof(SYM_TABLE_NODE)+strlen(name)+1)))
+	size=sizeof(SYM_TABLE_NODE)+strlen(name)+1;
+	if((newNode=(SYM_TABLE_NODE*)(table->arena?ArenaNewPtr(table->arena,size):NewPtr(size))))
 	{
 		newNode->data=data;
 		newNode->hashValue=STHash(name);
@@ -186,19 +272,10 @@ SYM_TABLE_NODE *STAddEntryAtStart(SYM_TABLE *table,const char *name,void *data)
 {
 	SYM_TABLE_NODE
 		*newNode;
-	unsigned int
-		hashIndex;
 
-	if((newNode=STCreateNode(name,data)))
+	if((newNode=STCreateNode(table,name,data)))
 	{
-		hashIndex=newNode->hashValue&((1<<table->hashTableBits)-1);
-		if(table->hashList[hashIndex])
-		{
-			table->hashList[hashIndex]->hashPrev=newNode;
-		}
-		newNode->hashNext=table->hashList[hashIndex];					// link into hash list
-		newNode->hashPrev=NULL;
-		table->hashList[hashIndex]=newNode;
+		STLinkHashNode(table,newNode);									// link into hash list
 
 		if(table->first)												// then link into ordered list
 		{
@@ -222,20 +299,10 @@ SYM_TABLE_NODE *STAddEntryAtEnd(SYM_TABLE *table,const char *name,void *data)
 {
 	SYM_TABLE_NODE
 		*newNode;
-	unsigned int
-		hashIndex;
 
-	if((newNode=STCreateNode(name,data)))
+	if((newNode=STCreateNode(table,name,data)))
 	{
-		hashIndex=newNode->hashValue&((1<<table->hashTableBits)-1);
-
-		if(table->hashList[hashIndex])
-		{
-			table->hashList[hashIndex]->hashPrev=newNode;
-		}
-		newNode->hashNext=table->hashList[hashIndex];					// link into hash list
-		newNode->hashPrev=NULL;
-		table->hashList[hashIndex]=newNode;
+		STLinkHashNode(table,newNode);									// link into hash list
 
 		if(table->last)													// then link into ordered list
 		{
@@ -316,24 +383,16 @@ void *STNodeData(SYM_TABLE_NODE *node)
 	return(node->data);
 }
 
+void STSetNodeData(SYM_TABLE_NODE *node,void *data)
+// Change the data of the passed symbol table node.
+{
+	node->data=data;
+}
+
 unsigned int STNumEntries(SYM_TABLE *table)
 // Returns the number of entries in the table.
 {
-	SYM_TABLE_NODE
-		*curEnt;
-	unsigned int
-		numEnts;
-
-	numEnts=0;
-
-	curEnt=table->first;
-	while(curEnt!=NULL)
-	{
-		numEnts++;
-		curEnt=curEnt->next;
-	}
-
-	return(numEnts);
+	return(table->numEntries);
 }
 
 void STDisposeSymbolTable(SYM_TABLE *table)
@@ -344,13 +403,14 @@ void STDisposeSymbolTable(SYM_TABLE *table)
 		*curEnt,
 		*tmpEnt;
 
-	curEnt=table->first;
+	curEnt=table->arena?NULL:table->first;		// nodes taken from an arena go when it is reset
 	while(curEnt)
 	{
 		tmpEnt=curEnt->next;
 		DisposePtr(curEnt);
 		curEnt=tmpEnt;
 	}
+	DisposePtr(table->hashList);
 	DisposePtr(table);
 }
 
@@ -370,25 +430,45 @@ SYM_TABLE *STNewSymbolTable(unsigned int expectedEntries)
 	if(expectedEntries)
 	{
 		hashTableBits=0;
-		while((hashTableBits<ST_MAX_HASH_TABLE_BITS)&&(((unsigned int)(1<<hashTableBits))<expectedEntries/2))	// shoot for two entries per hash bucket
+		while((hashTableBits<ST_DEFAULT_HASH_TABLE_BITS)&&(((unsigned int)(1<<hashTableBits))<expectedEntries/2))	// shoot for two entries per hash bucket
 		{
 			hashTableBits++;
 		}
 	}
 	else
 	{
-		hashTableBits=ST_MAX_HASH_TABLE_BITS;
+		hashTableBits=ST_DEFAULT_HASH_TABLE_BITS;
 	}
 
-	if((table=(SYM_TABLE*)NewPtr(sizeof(SYM_TABLE)+(1<<hashTableBits)*sizeof(SYM_TABLE_NODE *))))
+	if((table=(SYM_TABLE*)NewPtr(sizeof(SYM_TABLE))))
 	{
-		table->first=table->last=NULL;
-		table->hashTableBits=hashTableBits;
-		for(count=0;count<(unsigned int)(1<<hashTableBits);count++)
+		if((table->hashList=(SYM_TABLE_NODE **)NewPtr((1<<hashTableBits)*sizeof(SYM_TABLE_NODE *))))
 		{
-			table->hashList[count]=NULL;
+			table->first=table->last=NULL;
+			table->numEntries=0;
+			table->hashTableBits=hashTableBits;
+			table->arena=NULL;
+			for(count=0;count<(unsigned int)(1<<hashTableBits);count++)
+			{
+				table->hashList[count]=NULL;
+			}
+			return(table);
 		}
-		return(table);
+		DisposePtr(table);
 	}
 	return(NULL);
 }
+
+SYM_TABLE *STNewArenaSymbolTable(unsigned int expectedEntries,MEMORY_ARENA *arena)
+// Create a new symbol table whose nodes are allocated from arena.
+// NOTE: the table must be emptied (or disposed of) before the arena is reset.
+{
+	SYM_TABLE
+		*table;
+
+	if((table=STNewSymbolTable(expectedEntries)))
+	{
+		table->arena=arena;
+	}
+	return(table);
+}
@@ -27,6 +27,8 @@ SYM_TABLE_NODE *STFindNextEntry(SYM_TABLE *table,SYM_TABLE_NODE *previousEntry);
 SYM_TABLE_NODE *STFindPrevEntry(SYM_TABLE *table,SYM_TABLE_NODE *nextEntry);
 const char *STNodeName(SYM_TABLE_NODE *node);
 void *STNodeData(SYM_TABLE_NODE *node);
+void STSetNodeData(SYM_TABLE_NODE *node,void *data);
 unsigned int STNumEntries(SYM_TABLE *table);
 void STDisposeSymbolTable(SYM_TABLE *table);
 SYM_TABLE *STNewSymbolTable(unsigned int expectedEntries);
+SYM_TABLE *STNewArenaSymbolTable(unsigned int expectedEntries,MEMORY_ARENA *arena);
@@ -40,6 +40,15 @@ enum
 	T_DEBUG,
 	T_SHOW_PROCESSORS,
 	T_SHOW_OUTPUT_TYPES,
+	T_BATCH,
+	T_JOBS,
+	T_SERVE,
+	T_CACHE,
+	T_WARM_START,
+	T_DEPENDENCIES,
+	T_FILL,
+	T_WINDOW,
+	T_RECORD_LENGTH,
 };
 
 static const TOKEN_LIST
@@ -58,6 +67,15 @@ static const TOKEN_LIST
 		{"-p",T_DEBUG},
 		{"-show_procs",T_SHOW_PROCESSORS},
 		{"-show_types",T_SHOW_OUTPUT_TYPES},
+		{"-batch",T_BATCH},
+		{"-j",T_JOBS},
+		{"--serve",T_SERVE},
+		{"-cache",T_CACHE},
+		{"-warm",T_WARM_START},
+		{"-M",T_DEPENDENCIES},
+		{"-fill",T_FILL},
+		{"-window",T_WINDOW},
+		{"-record",T_RECORD_LENGTH},
 		{"",0}
 	};
 
@@ -115,62 +133,105 @@ bool ProcessLineLocationLabel(const PARSED_LABEL *parsedLabel)
 	return(!fail);
 }
 
-static bool ParseLine(char *line,LISTING_RECORD *listingRecord)
-// Handle parsing and assembling.
+static bool ParseProcessorLine(char *line,unsigned int *lineIndex,const char *name,unsigned int nameIndex,MNEMONIC *mnemonic,PARSED_LABEL *lineLabel,LISTING_RECORD *listingRecord)
+// The line is not a global pseudo-op, so try the processor's pseudo-ops, its opcodes,
+// then macros, in that order.
+// name is the name found at lineIndex (and nameIndex is just past it), or mnemonic
+// is NULL if there was no name.
+// Stages which mnemonic says cannot match are skipped, and the first time a name
+// is seen, the stage which matches it is remembered in mnemonic.
 // Return true if there was no "hard" failure.
 {
 	bool
 		result;
 	bool
 		hadMatch;
+	MACRO_RECORD
+		*macro;
+	char
+		string[MAX_STRING];
+
+	result=true;
+	hadMatch=false;
+	if(mnemonic&&(mnemonic->type==MN_UNKNOWN||mnemonic->type==MN_PROCESSOR_PSEUDO))
+	{
+		if((result=AttemptProcessorPseudoOpcode(line,lineIndex,lineLabel,listingRecord,&hadMatch))&&hadMatch)
+		{
+			mnemonic->type=MN_PROCESSOR_PSEUDO;
+		}
+	}
+	if(result&&!hadMatch)
+	{
+		if((result=ProcessLineLocationLabel(lineLabel)))		// label must be for the current location, so process it
+		{
+			if(mnemonic&&(mnemonic->type==MN_UNKNOWN||mnemonic->type==MN_OPCODE))
+			{
+				if((result=AttemptProcessorOpcode(line,lineIndex,listingRecord,&hadMatch))&&hadMatch)
+				{
+					mnemonic->type=MN_OPCODE;
+				}
+			}
+			if(result&&!hadMatch)
+			{
+				if(mnemonic&&mnemonic->type==MN_UNKNOWN)
+				{
+					mnemonic->type=MN_OTHER;
+				}
+				if(mnemonic&&(macro=MatchMnemonicMacro(mnemonic,name)))
+				{
+					*lineIndex=nameIndex;						// actually push forward on the line
+					result=InvokeMacro(macro,line,lineIndex,listingRecord);
+				}
+				else if(ParseNonWhiteSpace(line,lineIndex,string))	// something still remains?
+				{
+					AssemblyComplaint(NULL,true,"Unrecognized opcode '%s'\n",string);
+				}
+			}
+		}
+	}
+	return(result);
+}
+
+static bool ParseLine(char *line,LISTING_RECORD *listingRecord)
+// Handle parsing and assembling.
+// Return true if there was no "hard" failure.
+{
+	bool
+		result;
 	PARSED_LABEL
 		parsedLabel,
 		*lineLabel;
 	unsigned int
-		lineIndex;
+		lineIndex,
+		nameIndex;
 	char
-		string[MAX_STRING];
+		name[MAX_STRING];
+	MNEMONIC
+		*mnemonic;
 
 	result=true;		// assume no hard failure
 	lineIndex=0;
 	lineLabel=NULL;
-	hadMatch=false;		// nothing has matched this line yet
 	if(SkipWhiteSpace(line,&lineIndex)||(lineLabel=(ParseLabelDefinition(line,&lineIndex,&parsedLabel)?&parsedLabel:NULL))||ParseComment(line,&lineIndex))	// does the line begin correctly?
 	{
 		if((result=HandleAliasMatches(line,&lineIndex,listingRecord)))	// substitute opcode/operand aliases
 		{
-			if((result=AttemptGlobalPseudoOpcode(line,&lineIndex,lineLabel,listingRecord,&hadMatch)))
+			mnemonic=NULL;
+			nameIndex=lineIndex;
+			if(ParseName(line,&nameIndex,name))					// something that looks like an opcode?
 			{
-				if(!hadMatch)
+				result=LookupMnemonic(name,&mnemonic);			// find out what it is
+			}
+			if(result)
+			{
+				if(mnemonic&&mnemonic->type==MN_GLOBAL_PSEUDO)
 				{
-					if(contextStack->active)							// if not active, only a global pseudo-op can solve that, so ignore these lines
-					{
-						if((result=AttemptProcessorPseudoOpcode(line,&lineIndex,lineLabel,listingRecord,&hadMatch)))
-						{
-							if(!hadMatch)
-							{
-								if((result=ProcessLineLocationLabel(lineLabel)))		// label must be for the current location, so process it
-								{
-									if((result=AttemptProcessorOpcode(line,&lineIndex,listingRecord,&hadMatch)))
-									{
-										if(!hadMatch)
-										{
-											if((result=AttemptMacro(line,&lineIndex,listingRecord,&hadMatch)))
-											{
-												if(!hadMatch)
-												{
-													if(ParseNonWhiteSpace(line,&lineIndex,string))	// something still remains?
-													{
-														AssemblyComplaint(NULL,true,"Unrecognized opcode '%s'\n",string);
-													}
-												}
-											}
-										}
-									}
-								}
-							}
-						}
-					}
+					lineIndex=nameIndex;						// actually push forward on the line
+					result=mnemonic->pseudoOpcode->function(name,line,&lineIndex,lineLabel,listingRecord);
+				}
+				else if(contextStack->active)					// if not active, only a global pseudo-op can solve that, so ignore these lines
+				{
+					result=ParseProcessorLine(line,&lineIndex,name,nameIndex,mnemonic,lineLabel,listingRecord);
 				}
 			}
 		}
@@ -185,12 +246,14 @@ static bool ParseLine(char *line,LISTING_RECORD *listingRecord)
 	return(result);
 }
 
-static bool AssembleLine(char *line,char sourceType,bool wantList)
+static bool AssembleLine(char *line,char sourceType,bool wantList,bool isBlank)
 // Assemble the current source line
 // If there is a problem, (hard error), complain and return false
 // If there is a syntax error, or some sort of assembly problem
 // Do not complain about it until the last pass (assembly errors
 // are not considered failure for this routine).
+// If isBlank is true, the caller already knows the line holds nothing but
+// white space and comments, so it is listed (and collected) without being parsed.
 {
 	bool
 		fail;
@@ -208,6 +271,8 @@ static bool AssembleLine(char *line,char sourceType,bool wantList)
 		listingRecord.listPC=currentSegment->currentPC;
 	}
 	listingRecord.listObjectString[0]='\0';
+	listingRecord.listObjectWords=false;
+	listingRecord.numListObjectBytes=0;
 	listingRecord.wantList=wantList;
 	listingRecord.sourceType=sourceType;
 
@@ -216,7 +281,7 @@ static bool AssembleLine(char *line,char sourceType,bool wantList)
 	// this solves the problem 
 	wasCollecting=collectingBlock;
 
-	if(ParseLine(line,&listingRecord))
+	if(isBlank||ParseLine(line,&listingRecord))
 	{
 		// generate list output
 		OutputListFileLine(&listingRecord,line);			// dump the generated bytes to the list file
@@ -238,66 +303,6 @@ static bool AssembleLine(char *line,char sourceType,bool wantList)
 	return(!fail);
 }
 
-static bool GetLine(FILE *file,char *line,unsigned int lineLength,bool *atEOF,bool *overflow)
-// read a line from the given file into the array line
-// if there is a read error, return false
-// lineLength is considered to be the maximum number of characters
-// to read into the line (including the 0 terminator)
-// if the line fills before a CR is hit, overflow will be set true, and the rest of the
-// line will be read, but not stored
-// if the EOF is hit, atEOF is set true
-{
-	unsigned int
-		i;
-	int
-		result;
-	unsigned char
-		c;
-	bool
-		hadError;
-	bool
-		stopReading;
-
-	i=0;												// index into output line
-	stopReading=hadError=(*atEOF)=(*overflow)=false;	
-	while(!stopReading)
-	{
-		result=fgetc(file);
-		if(result!=EOF)									// if something was read, check it, and add to output line
-		{
-			c=(unsigned char)result;
-			if(c=='\n'||c=='\0')						// found termination?
-			{
-				stopReading=true;						// yes, output line is complete
-			}
-			else
-			{
-				if(c!='\r')								// see if the character should be added to the line
-				{
-					if(i<lineLength-1)					// make sure there is room to store it
-					{
-						line[i++]=c;					// store it if there is room
-					}
-					else
-					{
-						(*overflow)=true;				// complain of overflow, but continue to the end
-					}
-				}
-			}
-		}
-		else
-		{
-			stopReading=true;
-			(*atEOF)=true;								// tell caller that EOF was encountered
-		}
-	}
-	if(lineLength)
-	{
-		line[i]='\0';									// terminate the line if possible
-	}
-	return(!hadError);									// return error status
-}
-
 bool ProcessTextBlock(TEXT_BLOCK *block,TEXT_BLOCK *substitutionList,TEXT_BLOCK *substitutionText,char sourceType)
 // process the passed block of text into the assembly stream
 // NOTE: if substitutionList or substitutionText is NULL, no substitutions will occur
@@ -351,7 +356,7 @@ bool ProcessTextBlock(TEXT_BLOCK *block,TEXT_BLOCK *substitutionList,TEXT_BLOCK
 				}
 				if(!fail)
 				{
-					fail=!AssembleLine(inBuffer,sourceType,outputListingExpansions);
+					fail=!AssembleLine(inBuffer,sourceType,outputListingExpansions,false);
 					tempLine=tempLine->next;			// do next line
 				}
 			}
@@ -385,11 +390,15 @@ bool ProcessSourceFile(const char *fileName,bool huntForIt)
 // that could not be resolved.
 // numUnresolvedLabels will be incremented for each unresolved label encountered.
 // numModifiedLabels will be incremented each time a label's value is changed.
+// NOTE: the lines of the file are only read on the first pass which uses it, after
+// that they are replayed from memory.
 {
 	char
 		*inBuffer;									// character buffers for line parsing
-	FILE
-		*sourceFile;
+	SOURCE_FILE
+		*sourceLines;
+	SOURCE_LINE
+		*sourceLine;
 	unsigned int
 		oldLineNum;									// line number at entry
 	SYM_TABLE_NODE
@@ -397,8 +406,6 @@ bool ProcessSourceFile(const char *fileName,bool huntForIt)
 		*oldSourceFile;
 	bool
 		fail;
-	bool
-		overflow;
 
 	fail=false;
 
@@ -409,40 +416,41 @@ bool ProcessSourceFile(const char *fileName,bool huntForIt)
 		oldSourceFile=currentFile;
 		oldLineNum=currentFileLine;					// hold these until we are through
 
-		if((sourceFile=OpenSourceFile(&fileName[0],huntForIt,&newSourceFile)))
+		if(GetSourceFile(&fileName[0],huntForIt,&newSourceFile,&sourceLines))
 		{
-			if((inBuffer=(char *)NewPtr((int)(MAX_STRING))))
+			if(sourceLines)
 			{
-				currentFile=newSourceFile;
-				currentFileLine=0;
-				stopParsing=false;
-				while(!fail&&!stopParsing)
+				if((inBuffer=(char *)NewPtr((int)(MAX_STRING))))
 				{
-					if(GetLine(sourceFile,inBuffer,MAX_STRING,&stopParsing,&overflow))
+					currentFile=newSourceFile;
+					currentFileLine=0;
+					stopParsing=false;
+					sourceLine=sourceLines->firstLine;
+					while(!fail&&!stopParsing&&sourceLine)
 					{
-						currentFileLine++;				// increment the line because we just read one
+						currentFileLine++;				// increment the line because we are about to handle one
 						currentVirtualFile=currentFile;
 						currentVirtualFileLine=currentFileLine;
-						if(overflow)
+						if(sourceLine->flags&SLF_OVERFLOW)
 						{
 							AssemblyComplaint(NULL,false,"Line too long, truncation occurred\n");
 						}
-						fail=!AssembleLine(inBuffer,' ',true);
-					}
-					else
-					{
-						ReportComplaint(true,"Failed to read source line\n");
-						fail=true;
+						strcpy(inBuffer,&sourceLine->line[0]);	// copy it, since assembly may modify the line
+						fail=!AssembleLine(inBuffer,' ',true,(sourceLine->flags&SLF_BLANK)!=0);
+						sourceLine=sourceLine->next;
 					}
+					DisposePtr(inBuffer);
+				}
+				else
+				{
+					ReportComplaint(true,"Could not allocate memory for line input buffer\nOS Reports: %s\n",strerror(errno));
+					fail=true;
 				}
-				DisposePtr(inBuffer);
-			}
-			else
-			{
-				ReportComplaint(true,"Could not allocate memory for line input buffer\nOS Reports: %s\n",strerror(errno));
-				fail=true;
 			}
-			CloseSourceFile(sourceFile);
+		}
+		else
+		{
+			fail=true;
 		}
 
 		currentFile=oldSourceFile;
@@ -498,7 +506,7 @@ static bool ProcessAssembly()
 			if((currentSegment=CreateSegment("code",true)))		// set up a default segment to assemble into
 			{
 				numUnresolvedLabels=numModifiedLabels=0;	// reset these
-				scope[0]='\0';								// reset scope
+				SetLabelScope(NULL);						// reset scope
 				scopeCount=0;
 				scopeValue=0;
 				blockDepth=0;								// no macro invocations yet
@@ -557,10 +565,13 @@ static bool ProcessAssembly()
 		fail=true;											// some hard failure in select (it was reported there)
 	}
 
+	ForgetTextLines();										// kept text lines are in the pass arena too
+	ResetArena(passArena);									// everything made during the pass goes at once
+
 	return(!fail);
 }
 
-static bool HandleAssembly()
+bool HandleAssembly()
 // Assemble the source file(s), create output and list files as needed
 // If there is a problem, report it, and return false
 {
@@ -586,10 +597,17 @@ static bool HandleAssembly()
 
 		passCount=0;
 		intermediatePass=true;
-		fail=!ProcessAssembly();				// make first pass on source
+		if(warmStartFileName)
+		{
+			fail=!LoadLabelSeeds(warmStartFileName);	// let the first pass start from the label values of the last assembly
+		}
+		if(!fail)
+		{
+			fail=!ProcessAssembly();			// make first pass on source
+		}
 		passCount++;
 		lastNumUnresolvedLabels=numUnresolvedLabels;	// remember how many were unresolved this time
-		keepGoing=(numUnresolvedLabels!=0);		// if on first pass, nothing was unresolved, then we're done
+		keepGoing=(numUnresolvedLabels!=0)||numModifiedLabels;	// if on first pass, nothing was unresolved (or seeded wrongly), then we're done
 
 		while(!fail&&keepGoing)					// loop until we fail, or stop making progress with label resolution
 		{
@@ -622,11 +640,25 @@ static bool HandleAssembly()
 			if(!fail)
 			{
 				OutputListFileStats(totalTime);
+				if(!errorCount)
+				{
+					if(warmStartFileName)
+					{
+						fail=!SaveLabelSeeds(warmStartFileName);
+					}
+					if(!fail&&dependencyFileName)
+					{
+						fail=!WriteDependencyFile(dependencyFileName);
+					}
+				}
 			}
 		}
 		if(listFileName)							// if list file was desired, then close it
 		{
-			CloseTextOutputFile(listFile);
+			if(!CloseTextOutputFile(listFile))
+			{
+				fail=true;
+			}
 		}
 	}
 	else
@@ -639,7 +671,6 @@ static bool HandleAssembly()
 static void InitGlobals()
 // initialize program globals
 {
-	numAllocatedPointers=0;
 	infoOnly=false;						// assume we are actually assembling
 	strictPseudo=false;
 	displayWarnings=true;
@@ -656,40 +687,74 @@ static void InitGlobals()
 
 	sourceFileName=NULL;
 	listFileName=NULL;
+	batchFileName=NULL;
+	numBatchJobs=0;						// by default, run one batch assembly per processor
+	serveSocketName=NULL;
+	cacheDirectoryName=NULL;
+	warmStartFileName=NULL;
+	dependencyFileName=NULL;
+	binaryFill=0xFF;					// unprogrammed flash reads as all ones
+	binaryWindow=false;
+	binaryWindowStart=binaryWindowEnd=0;
+	hexRecordLength=DEFAULT_RECORD_LENGTH;
 	defaultProcessorName="";			// by default, select no processor
 }
 
 static void Usage()
-// print some messages to stderr that tell how to use this program
+// print some messages to stderr (or the thread's message file) that tell how to use this program
 {
-	fprintf(stderr,"\n");
-	fprintf(stderr,"%s version %s\n",programName,VERSION);
-	fprintf(stderr,"Copyright (C) 1999-2018 Core Technologies.\n");
-	fprintf(stderr,"\n");
-	fprintf(stderr,"Cross Assembler\n");
-	fprintf(stderr,"\n");
-	fprintf(stderr,"Usage: %s [opts] sourceFile [opts]\n",programName);
-	fprintf(stderr,"Assembly Options:\n");
-	fprintf(stderr,"\n");
-	fprintf(stderr,"   -h                Output this help message\n");
-	fprintf(stderr,"   -o type fileName  Output 'type' data to fileName\n");
-	fprintf(stderr,"                     Multiple -o options are allowed, all will be processed\n");
-	fprintf(stderr,"                     No output is generated by default\n");
-	fprintf(stderr,"   -I dir            Append dir to the list of directories searched by include\n");
-	fprintf(stderr,"   -d label value    Define a label to the given value\n");
-	fprintf(stderr,"   -P processor      Choose initial processor to assemble for\n");
-	fprintf(stderr,"   -n passes         Set maximum number of passes (default = %d)\n",DEFAULT_MAX_PASSES);
-	fprintf(stderr,"   -l listName       Create listing to listName\n");
-	fprintf(stderr,"   -s                Strict pseudo-ops -- limit global pseudo-ops to those that start with a dot\n");
-	fprintf(stderr,"   -w                Do not report warnings\n");
-	fprintf(stderr,"   -p                Print diagnostic messages to stderr\n");
-	fprintf(stderr,"\n");
-	fprintf(stderr,"\n");
-	fprintf(stderr,"Information Options:\n");
-	fprintf(stderr,"\n");
-	fprintf(stderr,"   -show_procs       Dump the supported processor list\n");
-	fprintf(stderr,"   -show_types       Dump the output file types list\n");
-	fprintf(stderr,"\n");
+	FILE
+		*file;
+
+	file=GetMessageFile();
+	fprintf(file,"\n");
+	fprintf(file,"%s version %s\n",programName,VERSION);
+	fprintf(file,"Copyright (C) 1999-2018 Core Technologies.\n");
+	fprintf(file,"\n");
+	fprintf(file,"Cross Assembler\n");
+	fprintf(file,"\n");
+	fprintf(file,"Usage: %s [opts] sourceFile [opts]\n",programName);
+	fprintf(file,"Assembly Options:\n");
+	fprintf(file,"\n");
+	fprintf(file,"   -h                Output this help message\n");
+	fprintf(file,"   -o type fileName  Output 'type' data to fileName\n");
+	fprintf(file,"                     Multiple -o options are allowed, all will be processed\n");
+	fprintf(file,"                     No output is generated by default\n");
+	fprintf(file,"   -fill value       Fill gaps in binary output with value (default = 0xFF)\n");
+	fprintf(file,"   -window start end Limit binary output to addresses start through end\n");
+	fprintf(file,"   -record length    Put up to length bytes in each hex or S-record (default = %d)\n",DEFAULT_RECORD_LENGTH);
+	fprintf(file,"   -I dir            Append dir to the list of directories searched by include\n");
+	fprintf(file,"   -d label value    Define a label to the given value\n");
+	fprintf(file,"   -P processor      Choose initial processor to assemble for\n");
+	fprintf(file,"   -n passes         Set maximum number of passes (default = %d)\n",DEFAULT_MAX_PASSES);
+	fprintf(file,"   -l listName       Create listing to listName\n");
+	fprintf(file,"   -M depName        Write a make rule to depName, naming every file the assembly read\n");
+	fprintf(file,"   -s                Strict pseudo-ops -- limit global pseudo-ops to those that start with a dot\n");
+	fprintf(file,"   -w                Do not report warnings\n");
+	fprintf(file,"   -p                Print diagnostic messages to stderr\n");
+	fprintf(file,"   -cache dir        Keep results in dir, and restore them when no input has changed\n");
+	fprintf(file,"   -warm fileName    Start labels with the values saved in fileName, and save the final values to it\n");
+	fprintf(file,"\n");
+	fprintf(file,"\n");
+	fprintf(file,"Batch Options:\n");
+	fprintf(file,"\n");
+	fprintf(file,"   -batch manifest   Run a separate assembly for each line of manifest\n");
+	fprintf(file,"                     Each line holds the options for its assembly, as they would be given here\n");
+	fprintf(file,"   -j jobs           Set number of batch assemblies to run at once (default = one per processor)\n");
+	fprintf(file,"\n");
+	fprintf(file,"\n");
+	fprintf(file,"Server Options:\n");
+	fprintf(file,"\n");
+	fprintf(file,"   --serve socket    Stay resident, running the assemblies sent to socket by --connect\n");
+	fprintf(file,"   --connect socket  Have the server at socket run this assembly (must be the first option)\n");
+	fprintf(file,"                     If no server is there, the assembly is run here instead\n");
+	fprintf(file,"\n");
+	fprintf(file,"\n");
+	fprintf(file,"Information Options:\n");
+	fprintf(file,"\n");
+	fprintf(file,"   -show_procs       Dump the supported processor list\n");
+	fprintf(file,"   -show_types       Dump the output file types list\n");
+	fprintf(file,"\n");
 }
 
 static void NotEnoughArgs(char *commandName)
@@ -810,6 +875,160 @@ static bool DoListName(unsigned int *currentArg,unsigned int argc,char *argv[])
 	return(false);
 }
 
+static bool DoBatch(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the name of the batch manifest
+{
+	if((*currentArg)+2<=argc)
+	{
+		(*currentArg)++;
+		batchFileName=argv[(*currentArg)++];
+		return(true);
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
+static bool DoJobs(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the number of batch assemblies to run at once
+{
+	if((*currentArg)+2<=argc)
+	{
+		(*currentArg)++;
+		numBatchJobs=strtol(argv[(*currentArg)++],NULL,0);
+		return(true);
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
+static bool DoServe(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the name of the socket to serve assemblies on
+{
+	if((*currentArg)+2<=argc)
+	{
+		(*currentArg)++;
+		serveSocketName=argv[(*currentArg)++];
+		return(true);
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
+static bool DoCache(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the name of the directory to cache assemblies in
+{
+	if((*currentArg)+2<=argc)
+	{
+		(*currentArg)++;
+		cacheDirectoryName=argv[(*currentArg)++];
+		return(true);
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
+static bool DoFill(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the byte used to fill gaps in binary output
+{
+	if((*currentArg)+2<=argc)
+	{
+		(*currentArg)++;
+		binaryFill=(unsigned char)strtol(argv[(*currentArg)++],NULL,0);
+		return(true);
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
+static bool DoWindow(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the range of addresses written to binary output
+{
+	if((*currentArg)+3<=argc)
+	{
+		(*currentArg)++;
+		binaryWindowStart=strtoul(argv[(*currentArg)++],NULL,0);
+		binaryWindowEnd=strtoul(argv[(*currentArg)++],NULL,0);
+		if(binaryWindowStart<=binaryWindowEnd)
+		{
+			binaryWindow=true;
+			return(true);
+		}
+		ReportComplaint(true,"Window start (0x%X) is after its end (0x%X)\n",binaryWindowStart,binaryWindowEnd);
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
+static bool DoRecordLength(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the most data bytes put in each hex or S-record
+{
+	if((*currentArg)+2<=argc)
+	{
+		(*currentArg)++;
+		hexRecordLength=strtol(argv[(*currentArg)++],NULL,0);
+		if(hexRecordLength>=1&&hexRecordLength<=255)
+		{
+			return(true);
+		}
+		ReportComplaint(true,"Record length must be from 1 to 255\n");
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
+static bool DoDependencies(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the name of the dependency file
+{
+	if((*currentArg)+2<=argc)
+	{
+		(*currentArg)++;
+		dependencyFileName=argv[(*currentArg)++];
+		return(true);
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
+static bool DoWarmStart(unsigned int *currentArg,unsigned int argc,char *argv[])
+// set the name of the file label values are warm started from
+{
+	if((*currentArg)+2<=argc)
+	{
+		(*currentArg)++;
+		warmStartFileName=argv[(*currentArg)++];
+		return(true);
+	}
+	else
+	{
+		NotEnoughArgs(argv[*currentArg]);
+	}
+	return(false);
+}
+
 static bool DoStrictPseudo(unsigned int *currentArg,unsigned int argc,char *argv[])
 // Limit assembler pseudo-ops to those that start with a '.'
 // This keeps the non-dotted versions from colliding with opcodes for
@@ -839,12 +1058,16 @@ static bool DoDebug(unsigned int *currentArg,unsigned int argc,char *argv[])
 static bool DoShowProcessors(unsigned int *currentArg,unsigned int argc,char *argv[])
 // dump the list of supported processors
 {
+	FILE
+		*file;
+
 	(*currentArg)++;
-	fprintf(stderr,"\n");
-	fprintf(stderr,"Supported processors:\n");
-	fprintf(stderr,"\n");
-	DumpProcessorInformation(stderr);
-	fprintf(stderr,"\n");
+	file=GetMessageFile();
+	fprintf(file,"\n");
+	fprintf(file,"Supported processors:\n");
+	fprintf(file,"\n");
+	DumpProcessorInformation(file);
+	fprintf(file,"\n");
 	infoOnly=true;		// tell parser that user just wanted info -- no assembly
 	return(true);
 }
@@ -852,12 +1075,16 @@ static bool DoShowProcessors(unsigned int *currentArg,unsigned int argc,char *ar
 static bool DoShowOutputTypes(unsigned int *currentArg,unsigned int argc,char *argv[])
 // dump the list of supported output file types
 {
+	FILE
+		*file;
+
 	(*currentArg)++;
-	fprintf(stderr,"\n");
-	fprintf(stderr,"Supported output types:\n");
-	fprintf(stderr,"\n");
-	DumpOutputFileTypeInformation(stderr);
-	fprintf(stderr,"\n");
+	file=GetMessageFile();
+	fprintf(file,"\n");
+	fprintf(file,"Supported output types:\n");
+	fprintf(file,"\n");
+	DumpOutputFileTypeInformation(file);
+	fprintf(file,"\n");
 	infoOnly=true;		// tell parser that user just wanted info -- no assembly
 	return(true);
 }
@@ -918,6 +1145,33 @@ static bool ParseCommandLine(unsigned int argc,char *argv[])
 				case T_SHOW_OUTPUT_TYPES:
 					DoShowOutputTypes(&currentArg,argc,argv);
 					break;
+				case T_BATCH:
+					fail=!DoBatch(&currentArg,argc,argv);
+					break;
+				case T_JOBS:
+					fail=!DoJobs(&currentArg,argc,argv);
+					break;
+				case T_SERVE:
+					fail=!DoServe(&currentArg,argc,argv);
+					break;
+				case T_CACHE:
+					fail=!DoCache(&currentArg,argc,argv);
+					break;
+				case T_WARM_START:
+					fail=!DoWarmStart(&currentArg,argc,argv);
+					break;
+				case T_DEPENDENCIES:
+					fail=!DoDependencies(&currentArg,argc,argv);
+					break;
+				case T_FILL:
+					fail=!DoFill(&currentArg,argc,argv);
+					break;
+				case T_WINDOW:
+					fail=!DoWindow(&currentArg,argc,argv);
+					break;
+				case T_RECORD_LENGTH:
+					fail=!DoRecordLength(&currentArg,argc,argv);
+					break;
 				default:
 					currentArg++;	// this token is processed
 					break;
@@ -945,7 +1199,17 @@ static bool ParseCommandLine(unsigned int argc,char *argv[])
 		}
 	}
 
-	if(!fail&&!sourceFileName&&!infoOnly)
+	if(!fail&&batchFileName&&sourceFileName)
+	{
+		ReportComplaint(true,"Source file name '%s' can not be given with -batch\n",sourceFileName);
+		fail=true;
+	}
+	if(!fail&&serveSocketName&&(sourceFileName||batchFileName))
+	{
+		ReportComplaint(true,"A source file name or -batch can not be given with --serve\n");
+		fail=true;
+	}
+	if(!fail&&!sourceFileName&&!batchFileName&&!serveSocketName&&!infoOnly)
 	{
 		ReportComplaint(true,"No source file name given\n");
 		fail=true;
@@ -956,71 +1220,132 @@ static bool ParseCommandLine(unsigned int argc,char *argv[])
 static void UnInitAssembler()
 // Call all the uninitialization routines
 {
-	UnInitProcessors();
+	UnInitMnemonics();
+	UnInitExpressions();
 	UnInitAliases();
 	UnInitMacros();
-	UnInitGlobalPseudoOpcodes();
 	UnInitOutputFileGenerate();
 	UnInitLabels();
 	UnInitSegments();
 	UnInitFiles();
+	UnInitMemory();
 }
 
 static bool InitAssembler()
 // Call all the initialization routines
 {
 	InitGlobals();									// start the ball rolling
-	if(InitFiles())
+	if(InitMemory())								// make the arenas everything else allocates from
 	{
-		if(InitSegments())							// initialize code segment handling
+		if(InitFiles())
 		{
-			if(InitLabels())						// initialize label handling
+			if(InitSegments())						// initialize code segment handling
 			{
-				if(InitOutputFileGenerate())
+				if(InitLabels())					// initialize label handling
 				{
-					if(InitGlobalPseudoOpcodes())		// create symbols for global pseudo ops
+					if(InitOutputFileGenerate())
 					{
-						if(InitMacros())				// initialize macro handling
+						if(InitMacros())			// initialize macro handling
 						{
 							if(InitAliases())
 							{
-								if(InitProcessors())		// set up all the processors
+								if(InitExpressions())	// initialize expression memoization
 								{
-									return(true);
+									if(InitMnemonics())	// initialize line dispatch
+									{
+										return(true);
+									}
+									UnInitExpressions();
 								}
 								UnInitAliases();
 							}
 							UnInitMacros();
 						}
-						UnInitGlobalPseudoOpcodes();
+						UnInitOutputFileGenerate();
 					}
-					UnInitOutputFileGenerate();
+					UnInitLabels();
 				}
-				UnInitLabels();
+				UnInitSegments();
 			}
-			UnInitSegments();
+			UnInitFiles();
 		}
-		UnInitFiles();
+		UnInitMemory();
 	}
 	return(false);
 }
 
-int main(int argc,char *argv[])
-// open source file, assemble it, output the results
+void UnInitAssemblerTables()
+// undo what InitAssemblerTables did
+{
+	UnInitProcessors();
+	UnInitGlobalPseudoOpcodes();
+	UnInitOutputFileTypes();
+	if(numSharedPointers)
+	{
+		fprintf(GetMessageFile(),"Yikes!! had %d un-deallocated shared pointers @ exit!\n",numSharedPointers);
+	}
+}
+
+bool InitAssemblerTables()
+// Create the tables which are only read during assembly (pseudo-ops, processors, opcodes
+// and output file types).
+// This must be called once, before any assembly is run. The tables are then
+// shared by all assemblies, including ones run at the same time by different threads.
+// NOTE: the opcode tables of a processor family are made the first time one of its
+// processors is selected
+{
+	if(InitOutputFileTypes())
+	{
+		if(InitGlobalPseudoOpcodes())				// create symbols for global pseudo ops
+		{
+			if(InitProcessors())					// set up all the processors
+			{
+				return(true);
+			}
+			UnInitGlobalPseudoOpcodes();
+		}
+		UnInitOutputFileTypes();
+	}
+	return(false);
+}
+
+bool RunAssembly(unsigned int argc,char *argv[])
+// Parse the command line arguments (argv[0] is skipped), assemble, and output the results
+// Each call is a complete assembly. Calls may be made one after another,
+// or at the same time from different threads (InitAssemblerTables must have been called first).
+// Return false if the assembly could not be done, or had errors
 {
+	unsigned int
+		startingPointers;
 	bool
-		fail;
+		fail,
+		batch;
 
 	fail=false;
-	programName=argv[0];								// point to the program name forever more
-
+	batch=false;
+	startingPointers=numAllocatedPointers;
 	if(InitAssembler())
 	{
-		if(ParseCommandLine((unsigned int)argc,argv))
+		if(ParseCommandLine(argc,argv))
 		{
 			if(!infoOnly)
 			{
-				fail=!HandleAssembly();
+				if(batchFileName)
+				{
+					batch=true;								// run below, once this assembly has let go of its state
+				}
+				else if(serveSocketName)
+				{
+					fail=!RunServer(serveSocketName);		// each assembly sent to the server is run on its own thread
+				}
+				else if(cacheDirectoryName)
+				{
+					fail=!RunCachedAssembly(cacheDirectoryName,argc,argv);	// restored from the cache if nothing has changed
+				}
+				else
+				{
+					fail=!HandleAssembly();
+				}
 			}
 		}
 		else
@@ -1036,14 +1361,54 @@ int main(int argc,char *argv[])
 		fail=true;
 	}
 
+	if(batch)
+	{
+		fail=!RunBatch(batchFileName,numBatchJobs);		// each line of the manifest is its own assembly (where there are no threads, they run on this one)
+	}
+
 	// check to see if leaking memory
-	if(numAllocatedPointers)
+	if(numAllocatedPointers!=startingPointers)
 	{
-		fprintf(stderr,"Yikes!! had %d un-deallocated pointers @ exit!\n",numAllocatedPointers);
+		fprintf(GetMessageFile(),"Yikes!! had %d un-deallocated pointers @ exit!\n",numAllocatedPointers-startingPointers);
+	}
+	return(!fail&&!errorCount);
+}
+
+#ifndef TPASM_LIBRARY										// libtpasm is built without main
+int main(int argc,char *argv[])
+// open source file, assemble it, output the results
+{
+	bool
+		fail;
+	bool
+		connected;
+
+	programName=argv[0];								// point to the program name forever more
+
+	connected=false;
+	if(argc>=3&&!strcmp(argv[1],"--connect"))			// see if the assembly should be handed to a server
+	{
+		fail=!RunClient(argv[2],(unsigned int)argc-3,&argv[3],&connected);
+		argc-=2;										// if there is no server, assemble the rest of the options here
+		argv+=2;
+	}
+	if(!connected)
+	{
+		if(InitAssemblerTables())
+		{
+			fail=!RunAssembly((unsigned int)argc,argv);
+			UnInitAssemblerTables();
+		}
+		else
+		{
+			ReportComplaint(true,"Failed to initialize\n");
+			fail=true;
+		}
 	}
-	if(fail||errorCount)
+	if(fail)
 	{
 		return(1);										// tell OS bad things happened
 	}
 	return(0);
 }
+#endif
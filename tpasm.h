@@ -17,4 +17,10 @@
 bool ProcessLineLocationLabel(const PARSED_LABEL *parsedLabel);
 bool ProcessTextBlock(TEXT_BLOCK *block,TEXT_BLOCK *substitutionList,TEXT_BLOCK *substitutionText,char sourceType);
 bool ProcessSourceFile(const char *fileName,bool huntForIt);
+bool HandleAssembly();
+void UnInitAssemblerTables();
+bool InitAssemblerTables();
+bool RunAssembly(unsigned int argc,char *argv[]);
+#ifndef TPASM_LIBRARY
 int main(int argc,char *argv[]);
+#endif